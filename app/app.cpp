@@ -19,6 +19,8 @@
 */
 
 #include "../modules/pipeline.hpp"
+#include "../modules/kernels.hpp"
+#include "../modules/fft.hpp"
 
 #include <boost/program_options.hpp>
 
@@ -29,6 +31,10 @@
 #include <sstream>
 #include <cstring>
 #include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 using namespace std;
 using namespace Segmenter;
@@ -44,6 +50,14 @@ struct Options
     int limit;
     bool features;
     bool binary;
+    bool native_rate;
+    bool validate_front_end;
+    MathContext math;
+    bool validate_math;
+    bool incremental_statistics;
+    float lookahead;
+    string index_filename;
+    string model_filename;
 
     Options() :
         block_size(4096 * 3),
@@ -51,61 +65,74 @@ struct Options
         resample_type(1),
         limit(0),
         features(false),
-        binary(true)
+        binary(true),
+        native_rate(false),
+        validate_front_end(false),
+        validate_math(false),
+        incremental_statistics(false),
+        lookahead(-1.f)
     {}
 };
 
+static const char * s_statisticNames[] = {
+    "Entropy Mean",
+    "Pitch Density Mean",
+    "Tonality Mean",
+    "Tonality 1 Mean",
+    "4 Hz Modulation Mean",
+    "MFCC 2 Mean",
+    "MFCC 3 Mean",
+    "MFCC 4 Mean",
+    "Entropy Delta Variance",
+    "Tonality Fluctuation",
+    "MFCC 2 Standard Deviation",
+    "MFCC 3 Standard Deviation",
+    "MFCC 4 Standard Deviation",
+    "MFCC 2 Delta Standard Deviation",
+    "MFCC 3 Delta Standard Deviation",
+    "MFCC 4 Delta Standard Deviation",
+    "Energy Gate Mean"
+};
+
+static const char * s_featureNames[] = {
+    "Energy",
+    "Energy Gate",
+    "Entropy",
+    "Pitch Density",
+    "Tonality",
+    "Tonality1",
+    "4 Hz Modulation",
+    "MFCC 2",
+    "MFCC 3",
+    "MFCC 4"
+};
+
+static const char * s_deltaNames[] = {
+    "Entropy Delta",
+    "MFCC 2 Delta",
+    "MFCC 3 Delta",
+    "MFCC 4 Delta"
+};
+
 static void printUsage(po::options_description opt_description)
 {
     cout << "Usage: extract file [options...]" << endl;
+    cout << "       extract query index [options...]" << endl;
     cout << opt_description << endl;
 }
 
 static void printHelpStatistics()
 {
-    static const char * strings[] = {
-        "Entropy Mean",
-        "Pitch Density Mean",
-        "Tonality Mean",
-        "Tonality 1 Mean",
-        "4 Hz Modulation Mean",
-        "MFCC 2 Mean",
-        "MFCC 3 Mean",
-        "MFCC 4 Mean",
-        "Entropy Delta Variance",
-        "Tonality Fluctuation",
-        "MFCC 2 Standard Deviation",
-        "MFCC 3 Standard Deviation",
-        "MFCC 4 Standard Deviation",
-        "MFCC 2 Delta Standard Deviation",
-        "MFCC 3 Delta Standard Deviation",
-        "MFCC 4 Delta Standard Deviation",
-        "Energy Gate Mean"
-    };
-
     cout << "Statistics output contains:" << endl;
-    for (int i = 0; i < sizeof(strings) / sizeof(char*); ++i)
-        cout << '\t' << i << ' ' << strings[i] << endl;
+    for (int i = 0; i < sizeof(s_statisticNames) / sizeof(char*); ++i)
+        cout << '\t' << i << ' ' << s_statisticNames[i] << endl;
 }
 
 static void printHelpFeatures()
 {
-    static const char * strings[] = {
-        "Energy",
-        "Energy Gate",
-        "Entropy",
-        "Pitch Density",
-        "Tonality",
-        "Tonality1",
-        "4 Hz Modulation",
-        "MFCC 2",
-        "MFCC 3",
-        "MFCC 4"
-    };
-
     cout << "Features output contains:" << endl;
-    for (int i = 0; i < sizeof(strings) / sizeof(char*); ++i)
-        cout << '\t' << i << ' ' << strings[i] << endl;
+    for (int i = 0; i < sizeof(s_featureNames) / sizeof(char*); ++i)
+        cout << '\t' << i << ' ' << s_featureNames[i] << endl;
 }
 
 void printOptions( Options & opt )
@@ -114,7 +141,10 @@ void printOptions( Options & opt )
     cout << '\t' << "- input: " << opt.input_filename << endl;
     cout << '\t' << "- output: " << opt.output_filename << endl;
     cout << '\t' << "- block size: " << opt.block_size << " samples" << endl;
-    if (opt.resample_rate > 0)
+    if (opt.resample_rate > 0 && opt.native_rate)
+        cout << '\t' << "- resampling: none, "
+             << opt.resample_rate << " Hz equivalent spectrum" << endl;
+    else if (opt.resample_rate > 0)
         cout << '\t' << "- resampling: "
              << opt.resample_rate << " Hz "
              << (opt.resample_type == 0 ? "(linear)" : "(sinc)")
@@ -125,8 +155,48 @@ void printOptions( Options & opt )
         cout << '\t' << "- limit: " << opt.limit << "%" << endl;
     else
         cout << '\t' << "- limit: none" << endl;
-    cout << '\t' << "- mode: " << (opt.features ? "features" : "statistics") << endl;
+    cout << '\t' << "- mode: " << (opt.features ? "features" : "statistics")
+         << (!opt.features && opt.incremental_statistics ? " (incremental)" : "") << endl;
+    if (!opt.features && opt.lookahead >= 0)
+        cout << '\t' << "- statistics: causal, " << opt.lookahead << " s lookahead" << endl;
+    else if (!opt.features)
+        cout << '\t' << "- statistics: centred" << endl;
     cout << '\t' << "- format: " << (opt.binary ? "binary" : "text") << endl;
+    if (!opt.index_filename.empty())
+        cout << '\t' << "- index: " << opt.index_filename << endl;
+    cout << '\t' << "- kernels: " << kernels().name << endl;
+    cout << '\t' << "- fft: " << fftBackendName( fftBackend() ) << endl;
+    cout << '\t' << "- fast math:"
+         << (opt.math.magnitude == MathContext::Fast ? " magnitude" : "")
+         << (opt.math.mfcc == MathContext::Fast ? " mfcc" : "")
+         << (opt.math.entropy == MathContext::Fast ? " entropy" : "")
+         << (opt.math.cepstrum == MathContext::Fast ? " cepstrum" : "")
+         << (opt.math.classifier == MathContext::Fast ? " classifier" : "")
+         << endl;
+}
+
+// Sets the modules named in a comma separated list to fast math
+static void parseFastMath( const string & list, MathContext & math )
+{
+    stringstream stream(list);
+    string name;
+    while (getline(stream, name, ','))
+    {
+        if (name == "all")
+            math = MathContext( MathContext::Fast );
+        else if (name == "magnitude")
+            math.magnitude = MathContext::Fast;
+        else if (name == "mfcc")
+            math.mfcc = MathContext::Fast;
+        else if (name == "entropy")
+            math.entropy = MathContext::Fast;
+        else if (name == "cepstrum")
+            math.cepstrum = MathContext::Fast;
+        else if (name == "classifier")
+            math.classifier = MathContext::Fast;
+        else
+            throw std::invalid_argument("Unknown fast math module: " + name);
+    }
 }
 
 
@@ -146,6 +216,26 @@ static bool parse_options( int argc, char **argv, Options & opt )
             ("resample,r", po::value<float>()->default_value(11025.f),
              "Resample to 'arg' sampling rate before feature extraction. 0 implies no resampling.")
             ("resample-linear", "Use linear instead of sinc resampling.")
+            ("native-rate", "Instead of resampling, analyse input at its own rate with a proportionally "
+             "larger transform, and use only the spectrum below half the '--resample' rate.")
+            ("validate-native-rate", "Compare features, statistics and classification "
+             "of the native rate and the resampling front end, instead of writing output.")
+            ("fast-math", po::value<string>()->implicit_value("all"),
+             "Use fast approximations of sqrt, log and exp in the modules given as a comma separated "
+             "list of: magnitude, mfcc, entropy, cepstrum, classifier; or all of them.")
+            ("validate-fast-math", "Compare features, statistics and classification "
+             "of fast math (as with '--fast-math', default all) and accurate math, instead of writing output.")
+            ("validate-model", po::value<string>(),
+             "Compare classification of the classifier model in file 'arg' "
+             "and the builtin model, instead of writing output.")
+            ("incremental-statistics", "Update statistics with the frames entering and leaving "
+             "the window, instead of summing each window anew.")
+            ("lookahead", po::value<float>(),
+             "Compute statistics of each frame from the past and at most 'arg' seconds "
+             "of future input, instead of a window centred on the frame.")
+            ("index", po::value<string>(),
+             "Also write a feature index to file 'arg', for statistics of any time range "
+             "with 'extract query'.")
             ("features,f", "Output raw features instead of statistics.")
             ("text,t", "Output text instead of binary.")
             ("limit,l", po::value<int>(), "Percentage of input to process.")
@@ -167,6 +257,20 @@ static bool parse_options( int argc, char **argv, Options & opt )
     opt.resample_type = var.count("resample-linear") ? 0 : 1;
     opt.features = var.count("features") > 0;
     opt.binary = var.count("text") == 0;
+    opt.native_rate = var.count("native-rate") > 0;
+    opt.validate_front_end = var.count("validate-native-rate") > 0;
+    if (!var["fast-math"].empty())
+        parseFastMath( var["fast-math"].as<string>(), opt.math );
+    opt.validate_math = var.count("validate-fast-math") > 0;
+    opt.incremental_statistics = var.count("incremental-statistics") > 0;
+    if (!var["lookahead"].empty())
+        opt.lookahead = std::max(0.f, var["lookahead"].as<float>());
+    if (!var["index"].empty())
+        opt.index_filename = var["index"].as<string>();
+    if (!var["validate-model"].empty())
+        opt.model_filename = var["validate-model"].as<string>();
+    if (opt.validate_math && var["fast-math"].empty())
+        opt.math = MathContext( MathContext::Fast );
     if (!var["limit"].empty())
         opt.limit = var["limit"].as<int>();
 
@@ -199,8 +303,284 @@ static bool parse_options( int argc, char **argv, Options & opt )
     return true;
 }
 
+static void makeContexts( const Options & opt, const SF_INFO & sf_info,
+                          InputContext & inCtx, FourierContext & fCtx, StatisticContext & statCtx )
+{
+    inCtx.sampleRate = sf_info.samplerate;
+    inCtx.blockSize = opt.block_size;
+    inCtx.resampleType = opt.resample_type == 0 ? SRC_LINEAR : SRC_SINC_FASTEST;
+    inCtx.frontEnd = opt.native_rate ? InputContext::NativeRateFrontEnd : InputContext::ResampledFrontEnd;
+
+    fCtx.sampleRate = opt.resample_rate > 0 ? opt.resample_rate : inCtx.sampleRate;
+    fCtx.blockSize = std::pow(2, std::floor( std::log(0.05 * fCtx.sampleRate) / std::log(2.0) ));
+    fCtx.stepSize = fCtx.blockSize / 2;
+
+    statCtx.blockSize = 3 * fCtx.sampleRate / fCtx.stepSize;
+    statCtx.stepSize = statCtx.blockSize / 6;
+    statCtx.incremental = opt.incremental_statistics;
+    if (opt.lookahead >= 0)
+        statCtx.lookahead = std::floor(opt.lookahead * fCtx.sampleRate / fCtx.stepSize + 0.5);
+    statCtx.featureIndex = !opt.index_filename.empty();
+}
+
+// Accumulates differences of a test output to a reference output, per channel
+struct Divergence
+{
+    vector<double> sumDifference;
+    vector<double> sumReference;
+    vector<double> maxDifference;
+    int count;
+
+    Divergence( int channels ):
+        sumDifference(channels, 0.0),
+        sumReference(channels, 0.0),
+        maxDifference(channels, 0.0),
+        count(0)
+    {}
+
+    void add( const float *reference, const float *test )
+    {
+        for (size_t c = 0; c < sumDifference.size(); ++c) {
+            double difference = std::fabs( (double) test[c] - reference[c] );
+            sumDifference[c] += difference;
+            sumReference[c] += std::fabs( (double) reference[c] );
+            maxDifference[c] = std::max( maxDifference[c], difference );
+        }
+        ++count;
+    }
+
+    void print( const char *title, const char **names ) const
+    {
+        cout << title << " (" << count << " frames):" << endl;
+        cout << "\tmean abs diff / mean abs ref\tmax abs diff\tname" << endl;
+        for (size_t c = 0; c < sumDifference.size(); ++c) {
+            cout << '\t' << (sumReference[c] > 0 ? sumDifference[c] / sumReference[c] : 0.0)
+                 << "\t\t\t" << maxDifference[c]
+                 << "\t\t" << names[c] << endl;
+        }
+    }
+};
+
+// Runs two pipelines side by side on the whole input,
+// and reports how far the test results are from the reference ones.
+static void comparePipelines( SNDFILE *sf, const SF_INFO & sf_info, const Options & opt,
+                              Pipeline & reference, Pipeline & test,
+                              const char *referenceName, const char *testName )
+{
+    Divergence featureDivergence( Statistics::INPUT_FEATURE_COUNT );
+    Divergence statisticDivergence( Statistics::OUTPUT_FEATURE_COUNT );
+    Divergence classDivergence( 1 );
+    int classChanges = 0;
+
+    // Outputs not yet matched by the other pipeline
+    vector<Statistics::InputFeatures> referenceFeatures, testFeatures;
+    vector<Statistics::OutputFeatures> referenceStatistics, testStatistics;
+    vector<float> referenceClasses, testClasses;
+
+    vector<float> input_buffer( opt.block_size );
+    bool endOfStream = false;
+    sf_count_t frames = 0;
+
+    do
+    {
+        sf_count_t frames_read = sf_read_float( sf, input_buffer.data(), opt.block_size );
+        endOfStream = frames_read < opt.block_size;
+        frames += frames_read;
+
+        Vamp::Plugin::FeatureList referenceList, testList;
+
+        reference.computeStatistics( input_buffer.data(), frames_read, endOfStream );
+        reference.computeClassification( referenceList );
+        test.computeStatistics( input_buffer.data(), frames_read, endOfStream );
+        test.computeClassification( testList );
+
+        referenceFeatures.insert( referenceFeatures.end(),
+                                  reference.features().begin(), reference.features().end() );
+        testFeatures.insert( testFeatures.end(), test.features().begin(), test.features().end() );
+        referenceStatistics.insert( referenceStatistics.end(),
+                                    reference.statistics().begin(), reference.statistics().end() );
+        testStatistics.insert( testStatistics.end(), test.statistics().begin(), test.statistics().end() );
+        for (size_t i = 0; i < referenceList.size(); ++i)
+            referenceClasses.push_back( referenceList[i].values[0] );
+        for (size_t i = 0; i < testList.size(); ++i)
+            testClasses.push_back( testList[i].values[0] );
+
+        int n = std::min( referenceFeatures.size(), testFeatures.size() );
+        for (int i = 0; i < n; ++i)
+            featureDivergence.add( referenceFeatures[i].data, testFeatures[i].data );
+        referenceFeatures.erase( referenceFeatures.begin(), referenceFeatures.begin() + n );
+        testFeatures.erase( testFeatures.begin(), testFeatures.begin() + n );
+
+        n = std::min( referenceStatistics.size(), testStatistics.size() );
+        for (int i = 0; i < n; ++i)
+            statisticDivergence.add( referenceStatistics[i].data, testStatistics[i].data );
+        referenceStatistics.erase( referenceStatistics.begin(), referenceStatistics.begin() + n );
+        testStatistics.erase( testStatistics.begin(), testStatistics.begin() + n );
+
+        n = std::min( referenceClasses.size(), testClasses.size() );
+        for (int i = 0; i < n; ++i) {
+            classDivergence.add( &referenceClasses[i], &testClasses[i] );
+            // classification is a weighted mean of classes 0 - 4, divided by 4
+            if (lroundf( referenceClasses[i] * 4 ) != lroundf( testClasses[i] * 4 ))
+                ++classChanges;
+        }
+        referenceClasses.erase( referenceClasses.begin(), referenceClasses.begin() + n );
+        testClasses.erase( testClasses.begin(), testClasses.begin() + n );
+
+        if (opt.limit > 0 && frames * 100 >= (sf_count_t) opt.limit * sf_info.frames)
+            break;
+    } while (!endOfStream);
+
+    static const char * classNames[] = { "Classification" };
+
+    featureDivergence.print( "Features", s_featureNames );
+    statisticDivergence.print( "Statistics", s_statisticNames );
+    classDivergence.print( "Classification", classNames );
+    cout << "\tnearest class differs in " << classChanges << " of " << classDivergence.count << " frames" << endl;
+    if (!referenceFeatures.empty() || !testFeatures.empty())
+        cout << "\tunmatched feature frames: " << referenceName << " " << referenceFeatures.size()
+             << ", " << testName << " " << testFeatures.size() << endl;
+}
+
+// Runs the resampling and the native rate front end side by side,
+// and reports how far the native rate results are from the resampled ones.
+static int validateNativeRate( SNDFILE *sf, const SF_INFO & sf_info, Options opt )
+{
+    InputContext inCtx;
+    FourierContext fCtx;
+    StatisticContext statCtx;
+
+    opt.native_rate = false;
+    makeContexts( opt, sf_info, inCtx, fCtx, statCtx );
+    Pipeline reference( inCtx, fCtx, statCtx, opt.math );
+
+    opt.native_rate = true;
+    makeContexts( opt, sf_info, inCtx, fCtx, statCtx );
+    Pipeline test( inCtx, fCtx, statCtx, opt.math );
+
+    if (test.inputContext().frontEnd != InputContext::NativeRateFrontEnd) {
+        cerr << "ERROR: Native rate front end not applicable to this input." << endl;
+        return 5;
+    }
+
+    std::cout << "-- validating native rate front end:"
+        << " transform size = " << test.transformSize()
+        << " at " << inCtx.sampleRate << " Hz"
+        << ", resampled transform size = " << reference.transformSize()
+        << " at " << fCtx.sampleRate << " Hz"
+        << endl;
+
+    comparePipelines( sf, sf_info, opt, reference, test, "resampled", "native" );
+
+    return 0;
+}
+
+// Runs accurate and fast math side by side,
+// and reports how far the fast math results are from the accurate ones.
+static int validateFastMath( SNDFILE *sf, const SF_INFO & sf_info, const Options & opt )
+{
+    InputContext inCtx;
+    FourierContext fCtx;
+    StatisticContext statCtx;
+    makeContexts( opt, sf_info, inCtx, fCtx, statCtx );
+
+    Pipeline reference( inCtx, fCtx, statCtx, MathContext( MathContext::Accurate ) );
+    Pipeline test( inCtx, fCtx, statCtx, opt.math );
+
+    std::cout << "-- validating fast math against accurate math" << endl;
+
+    comparePipelines( sf, sf_info, opt, reference, test, "accurate", "fast" );
+
+    return 0;
+}
+
+// Runs the builtin classifier model and one loaded from a file side by side,
+// and reports how far the classification of the loaded one is from the builtin one.
+static int validateModel( SNDFILE *sf, const SF_INFO & sf_info, const Options & opt )
+{
+    std::shared_ptr<const ClassifierModel> model = ClassifierModel::load( opt.model_filename );
+    if (!model) {
+        cerr << "ERROR: Can not read classifier model: " << opt.model_filename << endl;
+        return 5;
+    }
+
+    InputContext inCtx;
+    FourierContext fCtx;
+    StatisticContext statCtx;
+    makeContexts( opt, sf_info, inCtx, fCtx, statCtx );
+
+    Pipeline reference( inCtx, fCtx, statCtx, opt.math );
+    Pipeline test( inCtx, fCtx, statCtx, opt.math );
+    if (!test.setClassifierModel( model ))
+        return 5;
+
+    std::cout << "-- validating classifier model " << opt.model_filename
+        << " (" << model->inputCount() << " inputs, " << model->classCount() << " classes)"
+        << " against the builtin model" << endl;
+
+    comparePipelines( sf, sf_info, opt, reference, test, "builtin", "model" );
+
+    return 0;
+}
+
+// Prints gated statistics of each feature over a time range of a feature index
+static int query( int argc, char **argv )
+{
+    po::options_description desc("Allowed query options");
+    desc.add_options()
+            ("help,h", "Print this help.")
+            ("index,i", po::value<string>()->required(), "Index file written by 'extract --index'.")
+            ("from", po::value<double>()->default_value(0.0), "Start of range, in seconds.")
+            ("to", po::value<double>(), "End of range, in seconds; default is the end of the index.")
+    ;
+
+    po::positional_options_description positional_desc;
+    positional_desc.add("index", 1);
+
+    po::variables_map var;
+    try {
+        po::store(po::command_line_parser(argc, argv)
+                  .options(desc).positional(positional_desc).run(), var);
+        if (var.count("help")) {
+            cout << "Usage: extract query index [options...]" << endl;
+            cout << desc << endl;
+            return 0;
+        }
+        po::notify(var);
+    } catch (std::exception & e) {
+        cerr << "ERROR in options: " << e.what() << endl;
+        return 1;
+    }
+
+    const string filename = var["index"].as<string>();
+    FeatureIndex index;
+    if (!index.load( filename )) {
+        cerr << "ERROR: Failed to read feature index: " << filename << endl;
+        return 2;
+    }
+
+    const int begin = index.frame( var["from"].as<double>() );
+    const int end = var["to"].empty() ? index.frameCount() : index.frame( var["to"].as<double>() );
+
+    cout << "-- frames " << begin << " to " << end << " of " << index.frameCount()
+         << " at " << index.frameRate() << " frames per second" << endl;
+    cout << "Feature\tCount\tMean\tVariance\tStandard Deviation" << endl;
+    for (int c = 0; c < FeatureIndex::COLUMN_COUNT; ++c) {
+        const char *name = c < Statistics::INPUT_FEATURE_COUNT ?
+                    s_featureNames[c] : s_deltaNames[c - Statistics::INPUT_FEATURE_COUNT];
+        FeatureIndex::Summary summary = index.summary( c, begin, end );
+        cout << name << '\t' << summary.count << '\t' << summary.mean << '\t'
+             << summary.variance << '\t' << summary.stdDev << endl;
+    }
+
+    return 0;
+}
+
 int main ( int argc, char *argv[] )
 {
+    if (argc > 1 && string(argv[1]) == "query")
+        return query( argc - 1, argv + 1 );
+
     // parse options
 
     Options opt;
@@ -237,6 +617,24 @@ int main ( int argc, char *argv[] )
         return 3;
     }
 
+    if (opt.validate_front_end) {
+        int result = validateNativeRate( sf, sf_info, opt );
+        sf_close(sf);
+        return result;
+    }
+
+    if (opt.validate_math) {
+        int result = validateFastMath( sf, sf_info, opt );
+        sf_close(sf);
+        return result;
+    }
+
+    if (!opt.model_filename.empty()) {
+        int result = validateModel( sf, sf_info, opt );
+        sf_close(sf);
+        return result;
+    }
+
     // open output file
 
     fstream text_out;
@@ -269,18 +667,9 @@ int main ( int argc, char *argv[] )
     // create pipeline
 
     InputContext inCtx;
-    inCtx.sampleRate = sf_info.samplerate;
-    inCtx.blockSize = opt.block_size;
-    inCtx.resampleType = opt.resample_type == 0 ? SRC_LINEAR : SRC_SINC_FASTEST;
-
     FourierContext fCtx;
-    fCtx.sampleRate = opt.resample_rate > 0 ? opt.resample_rate : inCtx.sampleRate;
-    fCtx.blockSize = std::pow(2, std::floor( std::log(0.05 * fCtx.sampleRate) / std::log(2.0) ));
-    fCtx.stepSize = fCtx.blockSize / 2;
-
     StatisticContext statCtx;
-    statCtx.blockSize = 3 * fCtx.sampleRate / fCtx.stepSize;
-    statCtx.stepSize = statCtx.blockSize / 6;
+    makeContexts( opt, sf_info, inCtx, fCtx, statCtx );
 
     std::cout << "-- input sample rate = " << inCtx.sampleRate << endl;
 
@@ -289,13 +678,16 @@ int main ( int argc, char *argv[] )
         << ", step size = " << fCtx.stepSize
         << std::endl;
 
+    Pipeline * pipeline = new Pipeline( inCtx, fCtx, statCtx, opt.math );
+
+    if (pipeline->transformSize() != fCtx.blockSize)
+        std::cout << "-- native rate transform size = " << pipeline->transformSize() << std::endl;
+
     std::cout << "-- statistics"
         << " block size = " << statCtx.blockSize
         << ", step size = " << statCtx.stepSize
         << std::endl;
 
-    Pipeline * pipeline = new Pipeline( inCtx, fCtx, statCtx );
-
     // init processing
 
     float * input_buffer = new float[opt.block_size];
@@ -303,6 +695,10 @@ int main ( int argc, char *argv[] )
     int progress = 0;
     size_t frames_read = 0;
     bool endOfStream = false;
+    int statistics = 0;
+    int latencyCount = 0;
+    double latencySum = 0.0;
+    double latencyMax = 0.0;
 
     // go
 
@@ -332,6 +728,18 @@ int main ( int argc, char *argv[] )
         }
         else {
             int statN = pipeline->statistics().size();
+            if (!endOfStream) {
+                // input available when each statistics frame is output, past its own time
+                double now = double(frames + frames_read) / inCtx.sampleRate;
+                for (int t = 0; t < statN; ++t) {
+                    Vamp::RealTime time = pipeline->statisticsTime(statistics + t);
+                    double latency = now - (time.sec + time.nsec * 1e-9);
+                    latencySum += latency;
+                    latencyMax = std::max(latencyMax, latency);
+                    ++latencyCount;
+                }
+            }
+            statistics += statN;
             if (opt.binary) {
                 if (statN) {
                     sf_writef_float( sf_out,
@@ -368,6 +776,18 @@ int main ( int argc, char *argv[] )
 
     if (progress % 5 != 0)
         cout << progress << "%" << endl;
+
+    if (latencyCount)
+        cout << "-- statistics latency: mean = " << latencySum / latencyCount
+             << " s, max = " << latencyMax << " s" << endl;
+
+    if (!opt.index_filename.empty()) {
+        if (!endOfStream)
+            cout << "WARNING: Feature index covers only the processed part of the input." << endl;
+        if (!pipeline->featureIndex().save( opt.index_filename ))
+            cerr << "ERROR: Can not write feature index: " << opt.index_filename << endl;
+    }
+
     cout << "Done" << endl;
 
     // cleanup
@@ -0,0 +1,171 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "../modules/fft.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace Segmenter;
+
+struct Benchmark
+{
+    const char *name;
+    RealTransform::Kind kind;
+    int size;
+};
+
+// Transforms of the default 11025 Hz pipeline, and of the native rate front end at 44100 Hz
+static const Benchmark s_benchmarks[] = {
+    { "real fft(512)", RealTransform::RealToHalfComplex, 512 },
+    { "real fft(2048)", RealTransform::RealToHalfComplex, 2048 },
+    { "dct-ii(27)", RealTransform::Dct2, 27 },
+    { "dct-ii(257)", RealTransform::Dct2, 257 }
+};
+
+static const int s_benchmarkCount = sizeof(s_benchmarks) / sizeof(Benchmark);
+
+static volatile float s_sink;
+
+static double now()
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void fill( RealTransform & transform )
+{
+    srand(1);
+    for (int i = 0; i < transform.size(); ++i)
+        transform.input()[i] = (float) rand() / RAND_MAX - 0.5f;
+}
+
+static void run( RealTransform & transform, int iterations )
+{
+    float s = 0.f;
+    for (int i = 0; i < iterations; ++i) {
+        transform.execute();
+        s += transform.output()[i % transform.size()];
+    }
+    s_sink = s;
+}
+
+// Returns nanoseconds per call.
+static double measure( RealTransform & transform )
+{
+    int iterations = 100;
+    run( transform, iterations );
+
+    double best = 1e9;
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        double start = now();
+        run( transform, iterations );
+        double elapsed = now() - start;
+        if (elapsed < 0.01) {
+            iterations *= 2;
+            --repeat;
+            continue;
+        }
+        best = std::min( best, elapsed / iterations );
+    }
+    return best * 1e9;
+}
+
+// Largest difference to the reference, relative to its largest output
+static double difference( RealTransform & reference, RealTransform & transform )
+{
+    fill( reference );
+    fill( transform );
+    reference.execute();
+    transform.execute();
+
+    double maxDifference = 0, maxReference = 0;
+    for (int i = 0; i < reference.size(); ++i) {
+        maxDifference = std::max( maxDifference, (double) std::fabs( transform.output()[i] - reference.output()[i] ) );
+        maxReference = std::max( maxReference, (double) std::fabs( reference.output()[i] ) );
+    }
+    return maxReference > 0 ? maxDifference / maxReference : maxDifference;
+}
+
+int main()
+{
+    // Without FFTW, there is nothing to compare the builtin transforms to
+    const bool compare = hasTransform( FftwBackend, RealTransform::RealToHalfComplex, 512 );
+    if (!compare)
+        cout << "Built without FFTW: speed-ups and differences to FFTW are not shown." << endl;
+
+    cout << setw(20) << left << "transform [ns/call]";
+    for (int backend = 0; backend < FftBackendCount; ++backend)
+        cout << setw(18) << right << fftBackendName( (FftBackend) backend );
+    if (compare)
+        cout << setw(18) << right << "max rel diff";
+    cout << endl;
+
+    for (int b = 0; b < s_benchmarkCount; ++b)
+    {
+        const Benchmark & benchmark = s_benchmarks[b];
+        cout << setw(20) << left << benchmark.name;
+
+        RealTransform *reference = compare ?
+            createTransform( benchmark.kind, benchmark.size, FftwBackend ) : 0;
+        double referenceNs = 0;
+        double maxDifference = 0;
+
+        for (int backend = 0; backend < FftBackendCount; ++backend)
+        {
+            ostringstream cell;
+            if (hasTransform( (FftBackend) backend, benchmark.kind, benchmark.size ))
+            {
+                RealTransform *transform = createTransform( benchmark.kind, benchmark.size, (FftBackend) backend );
+                if (reference)
+                    maxDifference = std::max( maxDifference, difference( *reference, *transform ) );
+                fill( *transform );
+                double ns = measure( *transform );
+                cell << fixed << setprecision(1) << ns;
+                if (reference) {
+                    if (backend == FftwBackend)
+                        referenceNs = ns;
+                    cell << " (" << setprecision(1) << referenceNs / ns << "x)";
+                }
+                delete transform;
+            }
+            else
+            {
+                cell << "-";
+            }
+            cout << setw(18) << right << cell.str();
+        }
+
+        if (reference)
+            cout << setw(18) << right << maxDifference;
+        cout << endl;
+        delete reference;
+    }
+
+    return 0;
+}
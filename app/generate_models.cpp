@@ -0,0 +1,52 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*
+    Writes the classifier models compiled into the library as model files,
+    to be installed with it:
+
+        generate-models <output directory>
+*/
+
+#include "../modules/classifier_model.hpp"
+
+#include <cstdio>
+#include <string>
+
+using namespace Segmenter;
+
+int main( int argc, char **argv )
+{
+    if (argc != 2) {
+        std::fprintf( stderr, "Usage: generate-models <output directory>\n" );
+        return 1;
+    }
+
+    for (int i = 0; i < ClassifierModel::BuiltinModelCount; ++i) {
+        ClassifierModel::Builtin which = (ClassifierModel::Builtin) i;
+        std::string filename = std::string(argv[1]) + "/" + ClassifierModel::builtinFileName(which);
+        if (!ClassifierModel::builtin(which)->save( filename )) {
+            std::fprintf( stderr, "ERROR: Can not open output file for writing: %s\n", filename.c_str() );
+            return 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*
+    Writes the tables of the default configuration as a C++ header,
+    to be compiled into modules/tables.cpp:
+
+        generate-tables <output header>
+*/
+
+#include "../modules/tables.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Segmenter;
+
+namespace {
+
+// Default configuration, as set up by the extract app and the plugin
+const float s_sampleRate = 11025.f;
+const int s_blockSize = 512;
+const int s_stepSize = 256;
+const int s_melBandCount = 27;
+const int s_chromaticLoFreq = 55;
+const int s_chromaticHiFreq = 2000;
+const double s_modulationFrequency = 4.0;
+
+// Literal that reads back as the same float or double
+std::string literal( double value, bool isFloat )
+{
+    char text[64];
+    std::snprintf( text, sizeof(text), isFloat ? "%.9g" : "%.17g", value );
+    std::string result(text);
+    if (result.find_first_of(".en") == std::string::npos)
+        result += ".0";
+    if (isFloat)
+        result += "f";
+    return result;
+}
+
+void writeArray( FILE *file, const char *type, const char *name, const std::vector<std::string> & values )
+{
+    std::fprintf( file, "static const %s %s[%d] = {", type, name, (int) std::max<size_t>(values.size(), 1) );
+    for (size_t i = 0; i < values.size(); ++i)
+        std::fprintf( file, "%s%s", i % 8 ? " " : "\n    ", (values[i] + ",").c_str() );
+    if (values.empty())
+        std::fprintf( file, " 0" );
+    std::fprintf( file, "\n};\n" );
+}
+
+template <typename T>
+std::vector<std::string> literals( const T *values, int count, bool isFloat )
+{
+    std::vector<std::string> result;
+    for (int i = 0; i < count; ++i)
+        result.push_back( literal( values[i], isFloat ) );
+    return result;
+}
+
+std::vector<std::string> literals( const std::vector<int> & values )
+{
+    std::vector<std::string> result;
+    for (size_t i = 0; i < values.size(); ++i) {
+        char text[16];
+        std::snprintf( text, sizeof(text), "%d", values[i] );
+        result.push_back(text);
+    }
+    return result;
+}
+
+void writeFilterBank( FILE *file, const SparseFilterBank & filterBank )
+{
+    std::vector<int> rowPointers(1, 0);
+    std::vector<int> columnOffsets;
+    std::vector<float> coefficients;
+    for (int row = 0; row < filterBank.filterCount(); ++row) {
+        const float *filter = filterBank.filterCoefficients(row);
+        coefficients.insert( coefficients.end(), filter, filter + filterBank.filterSize(row) );
+        columnOffsets.push_back( filterBank.filterOffset(row) );
+        rowPointers.push_back( coefficients.size() );
+    }
+
+    std::fprintf( file, "static const int inputSize = %d;\n", filterBank.inputSize() );
+    std::fprintf( file, "static const int filterCount = %d;\n", filterBank.filterCount() );
+    writeArray( file, "int", "rowPointers", literals(rowPointers) );
+    writeArray( file, "int", "columnOffsets", literals(columnOffsets) );
+    writeArray( file, "float", "coefficients", literals(coefficients.data(), coefficients.size(), true) );
+}
+
+} // namespace
+
+int main( int argc, char **argv )
+{
+    if (argc != 2) {
+        std::fprintf( stderr, "Usage: generate-tables <output header>\n" );
+        return 1;
+    }
+
+    FILE *file = std::fopen( argv[1], "w" );
+    if (!file) {
+        std::fprintf( stderr, "ERROR: Can not open output file for writing: %s\n", argv[1] );
+        return 2;
+    }
+
+    std::fprintf( file,
+        "// Tables of the default configuration, generated by generate-tables.\n"
+        "// Do not edit.\n\n"
+        "#ifndef SEGMENTER_DEFAULT_TABLES_HPP_INCLUDED\n"
+        "#define SEGMENTER_DEFAULT_TABLES_HPP_INCLUDED\n\n"
+        "namespace Segmenter {\n"
+        "namespace DefaultTables {\n" );
+
+    {
+        std::vector<float> window;
+        Tables::buildHammingWindow( s_blockSize, window );
+
+        std::fprintf( file, "\nnamespace HammingWindow {\n" );
+        std::fprintf( file, "static const int size = %d;\n", s_blockSize );
+        writeArray( file, "float", "values", literals(window.data(), window.size(), true) );
+        std::fprintf( file, "}\n" );
+    }
+
+    {
+        // as in MelSpectrum
+        const double loFreq = 0;
+        const double hiFreq = 11025*0.5/s_sampleRate;
+        SparseFilterBank filterBank;
+        Tables::buildMelFilterBank( s_melBandCount, s_blockSize, s_sampleRate, loFreq, hiFreq, filterBank );
+
+        std::fprintf( file, "\nnamespace MelFilterBank {\n" );
+        std::fprintf( file, "static const int bandCount = %d;\n", s_melBandCount );
+        std::fprintf( file, "static const int windowSize = %d;\n", s_blockSize );
+        std::fprintf( file, "static const float sampleRate = %s;\n", literal(s_sampleRate, true).c_str() );
+        std::fprintf( file, "static const double loFreq = %s;\n", literal(loFreq, false).c_str() );
+        std::fprintf( file, "static const double hiFreq = %s;\n", literal(hiFreq, false).c_str() );
+        writeFilterBank( file, filterBank );
+        std::fprintf( file, "}\n" );
+    }
+
+    {
+        const int spectrumSize = s_blockSize / 2 + 1;
+        Tables::ChromaticFilters filters;
+        Tables::buildChromaticFilterBank( s_chromaticLoFreq, s_chromaticHiFreq, s_sampleRate,
+                                          spectrumSize, filters );
+
+        std::fprintf( file, "\nnamespace ChromaticFilterBank {\n" );
+        std::fprintf( file, "static const int loFreq = %d;\n", s_chromaticLoFreq );
+        std::fprintf( file, "static const int hiFreq = %d;\n", s_chromaticHiFreq );
+        std::fprintf( file, "static const float sampleRate = %s;\n", literal(s_sampleRate, true).c_str() );
+        std::fprintf( file, "static const int spectrumSize = %d;\n", spectrumSize );
+        writeFilterBank( file, filters.filterBank );
+        std::fprintf( file, "static const int frequencyCount = %d;\n", (int) filters.frequencies.size() );
+        writeArray( file, "float", "frequencies",
+                    literals(filters.frequencies.data(), filters.frequencies.size(), true) );
+        std::fprintf( file, "}\n" );
+    }
+
+    {
+        Tables::ModulationBasis basis;
+        Tables::buildModulationBasis( s_sampleRate, s_stepSize, s_modulationFrequency, basis );
+
+        std::fprintf( file, "\nnamespace ModulationBasis {\n" );
+        std::fprintf( file, "static const float sampleRate = %s;\n", literal(s_sampleRate, true).c_str() );
+        std::fprintf( file, "static const int hopSize = %d;\n", s_stepSize );
+        std::fprintf( file, "static const double frequency = %s;\n", literal(s_modulationFrequency, false).c_str() );
+        std::fprintf( file, "static const int length = %d;\n", basis.length );
+        writeArray( file, "double", "re", literals(basis.re.data(), basis.length, false) );
+        writeArray( file, "double", "im", literals(basis.im.data(), basis.length, false) );
+        std::fprintf( file, "static const double rotateRe = %s;\n", literal(basis.rotateRe, false).c_str() );
+        std::fprintf( file, "static const double rotateIm = %s;\n", literal(basis.rotateIm, false).c_str() );
+        std::fprintf( file, "static const double enterRe = %s;\n", literal(basis.enterRe, false).c_str() );
+        std::fprintf( file, "static const double enterIm = %s;\n", literal(basis.enterIm, false).c_str() );
+        std::fprintf( file, "}\n" );
+    }
+
+    std::fprintf( file,
+        "\n} // namespace DefaultTables\n"
+        "} // namespace Segmenter\n\n"
+        "#endif // SEGMENTER_DEFAULT_TABLES_HPP_INCLUDED\n" );
+
+    if (std::fclose(file) != 0) {
+        std::fprintf( stderr, "ERROR: Failed to write output file: %s\n", argv[1] );
+        return 2;
+    }
+
+    return 0;
+}
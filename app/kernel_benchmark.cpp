@@ -0,0 +1,263 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "../modules/kernels.hpp"
+#include "../modules/mel_spectrum.hpp"
+#include "../modules/entropy.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+using namespace Segmenter;
+
+// Sizes used by the default 11025 Hz pipeline.
+static const int s_blockSize = 512;
+static const int s_filterSize = 24;
+static const int s_statWindowSize = 129;
+static const int s_momentColumnCount = 12;
+static const int s_featureCount = 10;
+static const int s_batchSize = 32;
+static const int s_melBandCount = 27;
+static const int s_deltaFilterSize = 5;
+
+static volatile float s_sink;
+
+static double now()
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+struct Data
+{
+    vector<float> a, b, gate, out;
+
+    // overlapping feature columns, as read by Statistics
+    const float *columns[s_momentColumnCount];
+    float shifts[s_momentColumnCount];
+
+    // mel and chromatic filters, as stacked in Pipeline
+    SparseFilterBank bank;
+    FilterMatrix matrix;
+    vector<float> spectra, bands;
+
+    Data(): a(s_blockSize), b(s_blockSize), gate(s_blockSize), out(s_blockSize)
+    {
+        for (int i = 0; i < s_blockSize; ++i) {
+            a[i] = (float) rand() / RAND_MAX - 0.5f;
+            b[i] = (float) rand() / RAND_MAX;
+            gate[i] = rand() % 2 ? 1.f : 0.f;
+        }
+
+        for (int c = 0; c < s_momentColumnCount; ++c) {
+            columns[c] = a.data() + 32 * c;
+            shifts[c] = 0.1f;
+        }
+
+        const int spectrumSize = s_blockSize / 2 + 1;
+        MelSpectrum mel( 27, 11025, s_blockSize );
+        ChromaticEntropy chromatic( 11025, s_blockSize, 55, 2000 );
+        bank.append( mel.filterBank(), 0 );
+        bank.append( chromatic.filterBank(), spectrumSize );
+        matrix.append( mel.filterBank(), 0 );
+        matrix.append( chromatic.filterBank(), spectrumSize );
+
+        spectra.resize( s_batchSize * matrix.inputSize() );
+        for (size_t i = 0; i < spectra.size(); ++i)
+            spectra[i] = (float) rand() / RAND_MAX;
+        bands.resize( s_batchSize * matrix.outputSize() );
+    }
+};
+
+enum Benchmark {
+    SumOfSquares,
+    Multiply,
+    DotBlock,
+    DotFilter,
+    Axpy,
+    Fir,
+    MaskedMoments,
+    ClampedLog,
+    FastLog,
+    ClampedSqrt,
+    FastSqrt,
+    FastExp,
+    LargestFive,
+    FilterBankFrames,
+    FilterMatrixFrames,
+
+    BenchmarkCount
+};
+
+static const char * s_benchmarkNames[BenchmarkCount] = {
+    "sumOfSquares(512)",
+    "multiply(512)",
+    "dot(512)",
+    "dot(24)",
+    "axpy(10)",
+    "fir(5 taps, 32)",
+    "maskedMoments(12 x 129)",
+    "clampedLog(27)",
+    "fastLog(27)",
+    "clampedSqrt(257)",
+    "fastSqrt(257)",
+    "fastExp(4)",
+    "largestFive(257)",
+    "filter bank (32 frames)",
+    "filter matrix (32 frames)"
+};
+
+static void run( const Kernels & k, Benchmark b, Data & d, int iterations )
+{
+    float s = 0.f;
+    for (int i = 0; i < iterations; ++i) {
+        switch (b) {
+        case SumOfSquares:
+            s += k.sumOfSquares( d.a.data(), s_blockSize );
+            break;
+        case Multiply:
+            k.multiply( d.a.data(), d.b.data(), d.out.data(), s_blockSize );
+            s += d.out[i % s_blockSize];
+            break;
+        case DotBlock:
+            s += k.dot( d.a.data(), d.b.data(), s_blockSize );
+            break;
+        case DotFilter:
+            s += k.dot( d.a.data() + i % 64, d.b.data(), s_filterSize );
+            break;
+        case Axpy:
+            k.axpy( 0.1f, d.a.data() + i % 64, d.out.data(), s_featureCount );
+            s += d.out[0];
+            break;
+        case Fir:
+            k.fir( d.a.data() + i % 64, d.b.data(), s_deltaFilterSize, d.out.data(), s_batchSize );
+            s += d.out[0];
+            break;
+        case MaskedMoments:
+            k.maskedMoments( d.columns, d.shifts, s_momentColumnCount,
+                             d.gate.data(), s_statWindowSize, d.out.data() );
+            s += d.out[2];
+            break;
+        case ClampedLog:
+            k.clampedLog( d.b.data() + i % 64, 1.f / 65536, d.out.data(), s_melBandCount );
+            s += d.out[0];
+            break;
+        case FastLog:
+            k.fastLog( d.b.data() + i % 64, 1.f / 65536, d.out.data(), s_melBandCount );
+            s += d.out[0];
+            break;
+        case ClampedSqrt:
+            k.clampedSqrt( d.b.data() + i % 64, 1.f / 65536, d.out.data(), s_blockSize / 2 + 1 );
+            s += d.out[0];
+            break;
+        case FastSqrt:
+            k.fastSqrt( d.b.data() + i % 64, 1.f / 65536, d.out.data(), s_blockSize / 2 + 1 );
+            s += d.out[0];
+            break;
+        case FastExp:
+            k.fastExp( d.a.data() + i % 64, d.out.data(), 4 );
+            s += d.out[0];
+            break;
+        case LargestFive:
+        {
+            float largest[5];
+            k.largestFive( d.b.data() + i % 64, s_blockSize / 2 + 1, largest );
+            s += largest[4];
+            break;
+        }
+        case FilterBankFrames:
+            for (int f = 0; f < s_batchSize; ++f)
+                d.bank.process( d.spectra.data() + f * d.matrix.inputSize(),
+                                d.bands.data() + f * d.matrix.outputSize() );
+            s += d.bands[0];
+            break;
+        case FilterMatrixFrames:
+            d.matrix.process( d.spectra.data(), d.matrix.inputSize(), s_batchSize,
+                              d.bands.data(), d.matrix.outputSize() );
+            s += d.bands[0];
+            break;
+        default:
+            break;
+        }
+    }
+    s_sink = s;
+}
+
+// Returns nanoseconds per call.
+static double measure( const Kernels & k, Benchmark b, Data & d )
+{
+    int iterations = 1000;
+    run( k, b, d, iterations );
+
+    double best = 1e9;
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        double start = now();
+        run( k, b, d, iterations );
+        double elapsed = now() - start;
+        if (elapsed < 0.01) {
+            iterations *= 2;
+            --repeat;
+            continue;
+        }
+        best = std::min( best, elapsed / iterations );
+    }
+    return best * 1e9;
+}
+
+int main()
+{
+    Data data;
+
+    vector<const Kernels*> available;
+    for (int i = 0; i < InstructionSetCount; ++i) {
+        const Kernels *k = kernelsFor( (InstructionSet) i );
+        if (k)
+            available.push_back(k);
+    }
+
+    cout << setw(28) << left << "kernel [ns/call]";
+    for (size_t i = 0; i < available.size(); ++i)
+        cout << setw(18) << right << available[i]->name;
+    cout << endl;
+
+    for (int b = 0; b < BenchmarkCount; ++b) {
+        cout << setw(28) << left << s_benchmarkNames[b];
+        double scalar = 0;
+        for (size_t i = 0; i < available.size(); ++i) {
+            // filter banks go through kernels()
+            selectKernels( available[i]->instructionSet );
+            double ns = measure( *available[i], (Benchmark) b, data );
+            if (i == 0)
+                scalar = ns;
+            ostringstream cell;
+            cell << fixed << setprecision(1) << ns << " (" << setprecision(1) << scalar / ns << "x)";
+            cout << setw(18) << right << cell.str();
+        }
+        cout << endl;
+    }
+
+    return 0;
+}
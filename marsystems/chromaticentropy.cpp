@@ -18,6 +18,7 @@
 */
 
 #include "chromaticentropy.hpp"
+#include "../modules/entropy.hpp"
 #include "marsyas/common.h"
 
 #include <iostream>
@@ -70,7 +71,7 @@ ChromaticEntropy::myUpdate(MarControlPtr sender)
     mrs_natural loFreq = getControl("mrs_natural/lowestFrequency")->to<mrs_natural>();
     mrs_natural hiFreq = getControl("mrs_natural/highestFrequency")->to<mrs_natural>();
 
-    if ( !m_melFilters.size() ||
+    if ( !m_melFilters.filterCount() ||
          m_loFreq != loFreq ||
          m_hiFreq != hiFreq ||
          tisrate_ != israte_ ||
@@ -79,21 +80,11 @@ ChromaticEntropy::myUpdate(MarControlPtr sender)
         int nTimeSamples = (inObservations_ - 1) * 2;
         float timeSampleRate = israte_ * nTimeSamples;
 
-        initFilters( loFreq, hiFreq, timeSampleRate, inObservations_ );
-
-        m_melSpectrum.resize( m_melFilters.size() );
-#if 0
-        cout << "*** Mel Filters: ***" << endl;
-        for (int i=0; i < m_melFilters.size(); ++i)
-        {
-            Filter & filter = m_melFilters[i];
-            cout << m_melFreqs[i] << " @ " << filter.offset << " :";
-            for (int c=0; c < filter.coeffs.size(); ++c)
-                cout << " " << filter.coeffs[c];
-            cout << endl;
-        }
-        cout << "*** End Filters ***" << endl;
-#endif
+        Segmenter::ChromaticEntropy::initFilter( loFreq, hiFreq, timeSampleRate, inObservations_,
+                                                 m_melFilters, m_melFreqs );
+
+        m_melSpectrum.resize( m_melFilters.filterCount() );
+        m_spectrum.resize( inObservations_ );
     }
 
     m_loFreq = loFreq;
@@ -107,105 +98,20 @@ ChromaticEntropy::myUpdate(MarControlPtr sender)
 void
 ChromaticEntropy::myProcess(realvec& in, realvec& out)
 {
-    const int melBinCount = m_melFilters.size();
+    const int melBinCount = m_melFilters.filterCount();
 
     for (mrs_natural t = 0; t < inSamples_; ++t)
     {
         mrs_real * spectrum = in.getData() + t * inObservations_;
+        for (mrs_natural o = 0; o < inObservations_; ++o)
+            m_spectrum[o] = spectrum[o];
+
+        m_melFilters.process( m_spectrum.data(), m_melSpectrum.data() );
 
         float sum = 0;
         for (int melBin = 0; melBin < melBinCount; ++melBin)
-        {
-            const Filter & filter = m_melFilters[melBin];
-            const int filterSize = filter.coeffs.size();
-
-            float melPower = 0.f;
-            for (int bin = 0; bin < filterSize; ++bin)
-                melPower += spectrum[bin + filter.offset] * filter.coeffs[bin];
-
-            sum += melPower;
-            m_melSpectrum[melBin] = melPower;
-        }
-
-        float entropy = 0;
-        if (sum != 0)
-        {
-            static const double oneOverLog2 = 1.0 / std::log(2.0);
-
-            for (int melBin = 0; melBin < melBinCount; ++melBin)
-            {
-                float power = m_melSpectrum[melBin];
-                power /= sum;
-                if (power != 0)
-                    entropy += power * std::log(power) * oneOverLog2;
-            }
-            entropy *= -1;
-        }
-
-        out(0, t) = entropy;
-    }
-}
+            sum += m_melSpectrum[melBin];
 
-void ChromaticEntropy::initFilters( int loFreq, int hiFreq, float sampleRate, int powerBinCount )
-{
-    //cout << "filter args:" << " " << loFreq << " " << hiFreq << " " << sampleRate << " " << powerBinCount << endl;
-
-    m_melFilters.clear();
-
-    std::vector<float> freqs;
-    freqs.reserve(100);
-    int maxIndex = (int) std::floor( 12 * std::log( (float)hiFreq / loFreq ) / std::log(2) ) + 1;
-
-    for (int idx = -1; idx <= maxIndex; ++idx)
-        freqs.push_back( loFreq * std::pow( 2.0, (double) idx / 12 ) );
-
-    int nFreqs = freqs.size() - 2;
-    //int nSpecSize = std::ceil( (windowSize + 1.0) / 2 );
-    //int nSpecSize = windowSize / 2 + 1;
-    int nSpecSize = powerBinCount;
-
-    float * triangleHeight = new float[nFreqs];
-    for (int idx = 0; idx < nFreqs; idx++)
-        triangleHeight[idx] = 2.0f / (freqs[idx + 2] - freqs[idx]);
-
-    float * fft_freq = new float[nSpecSize];
-    for (int idx = 0; idx < nSpecSize - 1; idx++)
-        fft_freq[idx] = idx * sampleRate / 2 / (nSpecSize - 1);
-    fft_freq[nSpecSize - 1] = sampleRate / 2;
-#if 0
-    cout << "orig freqs: ";
-    for (int idx = 0; idx < nSpecSize; ++idx)
-        cout << fft_freq[idx] << " ";
-    cout << endl;
-#endif
-    m_melFilters.reserve(nFreqs);
-
-    for (int i = 0; i < nFreqs; i++)
-    {
-        Filter filter;
-        filter.offset = -1;
-        for (int j = 0; j < nSpecSize - 1; j++)
-        {
-            if (fft_freq[j] > freqs[i] && fft_freq[j] <= freqs[i + 1])
-            {
-                filter.offset = (filter.offset == -1 ? j : filter.offset);
-                filter.coeffs.push_back(
-                    triangleHeight[i] * (fft_freq[j] - freqs[i]) / (freqs[i + 1] - freqs[i])
-                );
-            }
-            else if (fft_freq[j] > freqs[i + 1] && fft_freq[j] < freqs[i + 2])
-            {
-                filter.offset = (filter.offset == -1 ? j : filter.offset);
-                filter.coeffs.push_back(
-                    triangleHeight[i] * (freqs[i + 2] - fft_freq[j]) / (freqs[i + 2] - freqs[i + 1])
-                );
-            }
-        }
-        m_melFilters.push_back(filter);
+        out(0, t) = Segmenter::ChromaticEntropy::entropy( m_melSpectrum.data(), melBinCount, sum );
     }
-
-    m_melFreqs = freqs;
-
-    delete[] triangleHeight;
-    delete[] fft_freq;
 }
@@ -21,6 +21,7 @@
 #define MARSYAS_CHROMATIC_ENTROPY_HPP
 
 #include "marsyas/MarSystem.h"
+#include "../modules/filter_bank.hpp"
 
 namespace Marsyas
 {
@@ -38,19 +39,14 @@ class marsyas_EXPORT ChromaticEntropy: public MarSystem
 private:
     void myUpdate(MarControlPtr sender);
     void addControls();
-    void initFilters( int loFreq, int hiFreq, float sampleRate, int powerBinCount );
-
-    struct Filter {
-        int offset;
-        std::vector<mrs_real> coeffs;
-    };
 
     mrs_natural m_loFreq;
     mrs_natural m_hiFreq;
 
-    std::vector<Filter> m_melFilters;
+    Segmenter::SparseFilterBank m_melFilters;
     std::vector<float> m_melFreqs;
     std::vector<float> m_melSpectrum;
+    std::vector<float> m_spectrum;
 
 public:
     ChromaticEntropy(std::string name);
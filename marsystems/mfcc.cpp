@@ -18,6 +18,7 @@
 */
 
 #include "mfcc.hpp"
+#include "../modules/mel_spectrum.hpp"
 
 #include <marsyas/common.h>
 #include <iostream>
@@ -30,8 +31,6 @@ namespace Marsyas {
 MyMFCC::MyMFCC(mrs_string name) :
     MarSystem("MyMFCC", name),
     m_filterCount(0),
-    m_melOffsets(0),
-    m_melCoeff(0),
     m_plan(0),
     m_dctIn(0),
     m_dctOut(0),
@@ -44,8 +43,6 @@ MyMFCC::MyMFCC(mrs_string name) :
 MyMFCC::MyMFCC(const MyMFCC& a) :
     MarSystem(a),
     m_filterCount(0),
-    m_melOffsets(0),
-    m_melCoeff(0),
     m_plan(0),
     m_dctIn(0),
     m_dctOut(0),
@@ -57,8 +54,6 @@ MyMFCC::MyMFCC(const MyMFCC& a) :
 
 MyMFCC::~MyMFCC()
 {
-    delete[] m_melOffsets;
-    delete[] m_melCoeff;
     fftwf_free(m_dctIn);
     fftwf_free(m_dctOut);
     fftwf_destroy_plan(m_plan);
@@ -147,16 +142,11 @@ MyMFCC::myProcess(realvec& in, realvec& out)
         for (int o = 0; o < inObservations_; ++o)
             m_buf(o) = std::sqrt( in(o,t) );
 
+        m_melFilters.process( m_buf.getData(), m_melOut );
+
         for (int filterIdx = 0; filterIdx < m_filterCount; ++filterIdx)
         {
-            const std::vector<float> & filter = m_melCoeff[filterIdx];
-            const int offset = m_melOffsets[filterIdx];
-            const int filterSize = filter.size();
-
-            float filterOut = 0;
-
-            for (int idx = 0; idx < filterSize; ++idx)
-                filterOut += filter[idx] * m_buf(offset + idx);
+            float filterOut = m_melOut[filterIdx];
 
             if (filterOut < ath)
                 filterOut = ath;
@@ -183,62 +173,7 @@ MyMFCC::myProcess(realvec& in, realvec& out)
 
 void MyMFCC::initMelFilters(int p, int n, int fs, double fl, double fh)
 {
-    delete[] m_melOffsets;
-    delete[] m_melCoeff;
-
-    m_melOffsets = new int[p];
-    m_melCoeff = new std::vector<float>[p];
-
-    double f0 = 700.0 / fs;
-    int fn2 = (int) std::floor(n / 2.0);
-    double lr = std::log((f0 + fh) / (f0 + fl)) / (p + 1);
-
-    double bl[] = {
-        n * ((f0 + fl) - f0),
-        n * ((f0 + fl) * std::exp(1 * lr) - f0),
-        n * ((f0 + fl) * std::exp(p * lr) - f0),
-        n * ((f0 + fl) * std::exp((p + 1) * lr) - f0)
-    };
-
-    int b2 = (int) std::ceil(bl[1]);
-    int b3 = (int) std::floor(bl[2]);
-    int b1 = (int) std::floor(bl[0]) + 1;
-    int b4 = (int) std::min( fn2, (int)std::ceil(bl[3]) ) - 1;
-
-    int len = b4 - b1 + 1;
-    double * pf = new double[len];
-    int * fp = new int[len];
-    double * pm = new double[len];
-    for (int idx = 0; idx <= b4 - b1; ++idx)
-    {
-        pf[idx] = std::log((f0 + (double)(idx + b1) / n) / (f0 + fl)) / lr;
-        fp[idx] = (int) std::floor(pf[idx]);
-        pm[idx] = pf[idx] - fp[idx];
-    }
-
-    int k2 = b2 - b1;
-    int k3 = b3 - b1;
-    int k4 = b4 - b1;
-
-    for (int idx = 0; idx < p; ++idx)
-        m_melOffsets[idx] = -1;
-
-    for (int idx = 0; idx <= k3; ++idx)
-    {
-        int filt = fp[idx];
-        m_melOffsets[filt] = (m_melOffsets[filt] == -1 ? idx + b1 : m_melOffsets[filt]);
-        m_melCoeff[filt].push_back((float)(2 * pm[idx]));
-    }
-    for (int idx = k2; idx <= k4; idx++)
-    {
-        int filt = fp[idx] - 1;
-        m_melOffsets[filt] = (m_melOffsets[filt] == -1 ? idx + b1 : m_melOffsets[filt]);
-        m_melCoeff[filt].push_back((float)(2 * (1 - pm[idx])));
-    }
-
-    delete[] pf;
-    delete[] fp;
-    delete[] pm;
+    Segmenter::MelSpectrum::initMelFilters(p, n, fs, fl, fh, m_melFilters);
 }
 
 } // namespace Marsyas
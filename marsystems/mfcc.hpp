@@ -23,6 +23,7 @@
 #include <marsyas/MarSystem.h>
 #include <vector>
 #include <fftw3.h>
+#include "../modules/filter_bank.hpp"
 
 namespace Marsyas
 {
@@ -41,8 +42,7 @@ private:
 
     int m_filterCount;
 
-    int * m_melOffsets;
-    std::vector<float> * m_melCoeff;
+    Segmenter::SparseFilterBank m_melFilters;
 
     fftwf_plan m_plan;
     float *m_dctIn;
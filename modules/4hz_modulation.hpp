@@ -22,71 +22,108 @@
 #define SEGMENTER_4HZ_MODULATION_INCLUDED
 
 #include "module.hpp"
+#include "tables.hpp"
 
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 namespace Segmenter {
 
+/*
+    Energy of 4 Hz modulation of mel bands: the sum over bands of
+    | sum of x[i] * cos(w i) | / sum of x[i], over the last N frames,
+    with i = 0 for the oldest frame.
+
+    The complex sum S = sum of x[i] * exp(j w i) is updated per frame
+    by a sliding DFT step, dropping the oldest frame and adding the newest:
+
+        S' = exp(-j w) * ( S - x[oldest] + x[newest] * exp(j w N) )
+
+    Sums are kept in double precision, and recomputed from the history
+    each time the ring buffer wraps, so rounding errors do not accumulate.
+*/
 class FourHzModulation : public Module
 {
-    std::vector<float> m_filter;
+    int m_bandCount;
+    int m_length;
+
+    // exp(j w i) for i in [0, N), exp(-j w) and exp(j w N)
+    std::shared_ptr<const Tables::ModulationBasis> m_basis;
 
-    std::vector< std::vector<float> > m_buf;
+    // band-major ring of the last N frames of each band
+    std::vector<float> m_history;
     int m_iBufWrite;
 
+    std::vector<double> m_sumRe;
+    std::vector<double> m_sumIm;
+    std::vector<double> m_total;
+
     float m_output;
 
 public:
-    FourHzModulation( float sampleRate, int windowSize, int hopSize ):
+    FourHzModulation( float sampleRate, int bandCount, int hopSize ):
+        m_bandCount(bandCount),
         m_iBufWrite(0),
         m_output(0.f)
     {
-        const double pi = Segmenter::pi();
-
-        double dt = hopSize / (double) sampleRate;
-        int nFilter = std::ceil( 0.5 / dt );
-        m_filter.reserve(nFilter);
-        for (int i = 0; i < nFilter; ++i)
-            m_filter.push_back( cos( 4 * 2 * pi * i * dt ) );
-
-        int spectrumSize = windowSize / 2 + 1;
-        m_buf.resize( nFilter );
-        for (int i = 0; i < nFilter; ++i)
-            m_buf[i].resize(spectrumSize);
+        m_basis = Tables::modulationBasis( sampleRate, hopSize, 4.0 );
+
+        const int nFilter = m_basis->length;
+        m_length = nFilter;
+
+        m_history.resize( bandCount * nFilter, 0.f );
+        m_sumRe.resize( bandCount, 0.0 );
+        m_sumIm.resize( bandCount, 0.0 );
+        m_total.resize( bandCount, 0.0 );
     }
 
     void process( const std::vector<float> & melSpectrum )
     {
-        int nSpectrum = melSpectrum.size();
-        int nFilter = m_filter.size();
+        const int nSpectrum = std::min( (int) melSpectrum.size(), m_bandCount );
+        const int nFilter = m_length;
+        const int iOldest = m_iBufWrite;
 
-        std::memcpy( m_buf[m_iBufWrite].data(), melSpectrum.data(), nSpectrum * sizeof(float) );
         ++m_iBufWrite;
         if (m_iBufWrite >= nFilter)
             m_iBufWrite = 0;
 
+        const bool reanchor = m_iBufWrite == 0;
+        const Tables::ModulationBasis & basis = *m_basis;
+
         float filteredSpectrumEnergy = 0.f;
 
         for (int iSpec = 0; iSpec < nSpectrum; ++iSpec)
         {
-            float filteredBin = 0.f;
-            float totalBinEnergy = 0.f;
-            // process 2 parts of the circular buffer:
-            int iFilter, iBuf;
-            for( iBuf = m_iBufWrite, iFilter = 0; iBuf < nFilter; ++iBuf, ++iFilter )
+            float *history = m_history.data() + iSpec * nFilter;
+            const double x = melSpectrum[iSpec];
+            const double oldest = history[iOldest];
+            history[iOldest] = melSpectrum[iSpec];
+
+            double & sumRe = m_sumRe[iSpec];
+            double & sumIm = m_sumIm[iSpec];
+            double & total = m_total[iSpec];
+
+            if (reanchor)
             {
-                float x = m_buf[iBuf][iSpec];
-                filteredBin += x * m_filter[iFilter];
-                totalBinEnergy += x;
+                // the oldest frame is now in slot 0
+                sumRe = sumIm = total = 0.0;
+                for (int i = 0; i < nFilter; ++i) {
+                    sumRe += history[i] * basis.re[i];
+                    sumIm += history[i] * basis.im[i];
+                    total += history[i];
+                }
             }
-            for( iBuf = 0; iBuf < m_iBufWrite; ++iBuf, ++iFilter )
+            else
             {
-                float x = m_buf[iBuf][iSpec];
-                filteredBin += x * m_filter[iFilter];
-                totalBinEnergy += x;
+                double re = sumRe - oldest + x * basis.enterRe;
+                double im = sumIm + x * basis.enterIm;
+                sumRe = re * basis.rotateRe - im * basis.rotateIm;
+                sumIm = re * basis.rotateIm + im * basis.rotateRe;
+                total += x - oldest;
             }
 
-            float filteredBinEnergy = std::abs(filteredBin) / totalBinEnergy;
+            float filteredBinEnergy = std::abs((float) sumRe) / (float) total;
             filteredSpectrumEnergy += filteredBinEnergy;
         }
 
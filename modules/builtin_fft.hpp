@@ -0,0 +1,672 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_BUILTIN_FFT_HPP_INCLUDED
+#define SEGMENTER_BUILTIN_FFT_HPP_INCLUDED
+
+#include "module.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace Segmenter {
+
+/*
+    Transforms without dependencies, in the conventions of FFTW.
+    BuiltinRealFft has its size fixed at compile time, for the powers of two
+    of the resampled front end. The others take any size, as the native rate
+    front end transforms frames such as 2229 samples at 48 kHz, and the
+    cepstrum a DCT of N/2 + 1 points. Tables and buffers are made
+    at construction, so execute() does not allocate.
+*/
+
+/*
+    Real transform of N = 2^k samples to FFTW's half-complex format (FFTW_R2HC):
+    out[k] = Re X[k] for k in [0, N/2], out[N - k] = Im X[k] for k in (0, N/2).
+
+    Even and odd samples are transformed together as the real and imaginary
+    part of an N/2 point complex sequence z, by an iterative radix-2 FFT;
+    the spectrum of x is then separated from Z:
+
+        X[k] = (Z[k] + conj Z[N/2 - k]) / 2 - j W_N^k (Z[k] - conj Z[N/2 - k]) / 2
+*/
+template <int N>
+class BuiltinRealFft
+{
+    static const int M = N / 2;
+
+    float m_input[N];
+    float m_output[N];
+
+    // complex sequence being transformed, interleaved
+    float m_z[N];
+    int m_bitReversed[M];
+    // W_M^k for k in [0, M/2), and W_N^k for k in [0, M/2], interleaved
+    float m_twiddles[M];
+    float m_splitTwiddles[M + 2];
+
+public:
+    BuiltinRealFft()
+    {
+        const double pi = Segmenter::pi();
+
+        int bits = 0;
+        while ((1 << bits) < M)
+            ++bits;
+        for (int i = 0; i < M; ++i) {
+            int reversed = 0;
+            for (int b = 0; b < bits; ++b)
+                reversed |= ((i >> b) & 1) << (bits - 1 - b);
+            m_bitReversed[i] = reversed;
+        }
+
+        for (int k = 0; k < M / 2; ++k) {
+            m_twiddles[2 * k] = std::cos( 2 * pi * k / M );
+            m_twiddles[2 * k + 1] = - std::sin( 2 * pi * k / M );
+        }
+        for (int k = 0; k <= M / 2; ++k) {
+            m_splitTwiddles[2 * k] = std::cos( 2 * pi * k / N );
+            m_splitTwiddles[2 * k + 1] = - std::sin( 2 * pi * k / N );
+        }
+
+        for (int i = 0; i < N; ++i)
+            m_input[i] = m_output[i] = 0.f;
+    }
+
+    static int size() { return N; }
+    float * input() { return m_input; }
+    const float * output() const { return m_output; }
+
+    void execute()
+    {
+        float *z = m_z;
+
+        for (int i = 0; i < M; ++i) {
+            const int j = m_bitReversed[i];
+            z[2 * j] = m_input[2 * i];
+            z[2 * j + 1] = m_input[2 * i + 1];
+        }
+
+        for (int half = 1, stride = M / 2; half < M; half *= 2, stride /= 2) {
+            for (int start = 0; start < M; start += 2 * half) {
+                float *a = z + 2 * start;
+                float *b = a + 2 * half;
+                const float *w = m_twiddles;
+                for (int i = 0; i < half; ++i, w += 2 * stride) {
+                    float re = b[2 * i] * w[0] - b[2 * i + 1] * w[1];
+                    float im = b[2 * i] * w[1] + b[2 * i + 1] * w[0];
+                    b[2 * i] = a[2 * i] - re;
+                    b[2 * i + 1] = a[2 * i + 1] - im;
+                    a[2 * i] += re;
+                    a[2 * i + 1] += im;
+                }
+            }
+        }
+
+        float *out = m_output;
+        out[0] = z[0] + z[1];
+        out[M] = z[0] - z[1];
+
+        for (int k = 1; k <= M / 2; ++k) {
+            const int l = M - k;
+            // even and odd parts, E = (Z[k] + conj Z[l]) / 2, O = (Z[k] - conj Z[l]) / 2j
+            float evenRe = 0.5f * (z[2 * k] + z[2 * l]);
+            float evenIm = 0.5f * (z[2 * k + 1] - z[2 * l + 1]);
+            float oddRe = 0.5f * (z[2 * k + 1] + z[2 * l + 1]);
+            float oddIm = - 0.5f * (z[2 * k] - z[2 * l]);
+            const float *w = m_splitTwiddles + 2 * k;
+            float re = oddRe * w[0] - oddIm * w[1];
+            float im = oddRe * w[1] + oddIm * w[0];
+            // X[k] = E + W_N^k O, X[M - k] = conj(E - W_N^k O)
+            out[k] = evenRe + re;
+            out[N - k] = evenIm + im;
+            if (k != l) {
+                out[l] = evenRe - re;
+                out[N - l] = - (evenIm - im);
+            }
+        }
+    }
+};
+
+/*
+    Complex DFT of any size N, X[k] = sum x[n] W_N^(n k), with interleaved
+    real and imaginary parts:
+    - N = 2^a 3^b: mixed radix decimation in time,
+      with radix 4 butterflies where possible;
+    - other prime N: Rader's algorithm, a cyclic convolution of length N - 1;
+    - otherwise: Bluestein's algorithm, a convolution of a power of two length.
+    Convolutions use the DFT of their length.
+*/
+class BuiltinDft
+{
+public:
+    enum Method { MixedRadix, Rader, Bluestein };
+
+    struct Plan
+    {
+        static const int maxRadix = 4;
+
+        int size;
+        Method method;
+        // MixedRadix: radices, outermost first
+        std::vector<int> factors;
+        // MixedRadix: W_N^i, i in [0, N)
+        std::vector<float> twiddles;
+        // Rader and Bluestein: length of the convolution
+        int convolutionSize;
+        // Rader: g^q and g^-q mod N, for q in [0, N - 1)
+        std::vector<int> inputOrder;
+        std::vector<int> outputOrder;
+        // Bluestein: exp(-j pi n^2 / N), n in [0, N)
+        std::vector<float> chirp;
+        // Rader and Bluestein: spectrum of the convolution kernel, over its length
+        std::vector<float> kernel;
+
+        explicit Plan( int n );
+    };
+
+    explicit BuiltinDft( int size ):
+        m_plan(size)
+    {
+        if (m_plan.method != MixedRadix) {
+            m_convolution.reset( new BuiltinDft( m_plan.convolutionSize ) );
+            m_work.resize( 2 * m_plan.convolutionSize );
+            m_spectrum.resize( 2 * m_plan.convolutionSize );
+        }
+    }
+
+    int size() const { return m_plan.size; }
+    Method method() const { return m_plan.method; }
+
+    // out = DFT of in, both of size() complex values; 'out' must not overlap 'in'
+    void execute( const float * in, float * out )
+    {
+        switch (m_plan.method) {
+        case MixedRadix:
+            if (m_plan.size == 1) {
+                out[0] = in[0];
+                out[1] = in[1];
+            }
+            else {
+                mixedRadix( in, 1, out, m_plan.size, 0, 1 );
+            }
+            break;
+        case Rader:
+            rader( in, out );
+            break;
+        case Bluestein:
+            bluestein( in, out );
+            break;
+        }
+    }
+
+private:
+    void mixedRadix( const float * in, int inStride, float * out, int n, int factorIndex, int twiddleStride )
+    {
+        const int p = m_plan.factors[factorIndex];
+        const int m = n / p;
+
+        // sub-transforms of the p interleaved subsequences, one after another
+        if (m == 1) {
+            for (int q = 0; q < p; ++q) {
+                out[2 * q] = in[2 * q * inStride];
+                out[2 * q + 1] = in[2 * q * inStride + 1];
+            }
+        }
+        else {
+            for (int q = 0; q < p; ++q)
+                mixedRadix( in + 2 * q * inStride, inStride * p, out + 2 * q * m, m,
+                            factorIndex + 1, twiddleStride * p );
+        }
+
+        // X[k + s m] = sum over q of W_p^(q s) W_n^(q k) Y_q[k]
+        const float *w = m_plan.twiddles.data();
+        float t[2 * Plan::maxRadix];
+
+        for (int k = 0; k < m; ++k)
+        {
+            for (int q = 0; q < p; ++q) {
+                const float *y = out + 2 * (q * m + k);
+                const float *tw = w + 2 * (q * k * twiddleStride);
+                t[2 * q] = y[0] * tw[0] - y[1] * tw[1];
+                t[2 * q + 1] = y[0] * tw[1] + y[1] * tw[0];
+            }
+
+            float *x = out + 2 * k;
+            const int s = 2 * m;
+            if (p == 2) {
+                x[0] = t[0] + t[2];
+                x[1] = t[1] + t[3];
+                x[s] = t[0] - t[2];
+                x[s + 1] = t[1] - t[3];
+            }
+            else if (p == 4) {
+                // W_4 = -j
+                float aRe = t[0] + t[4], aIm = t[1] + t[5];
+                float bRe = t[0] - t[4], bIm = t[1] - t[5];
+                float cRe = t[2] + t[6], cIm = t[3] + t[7];
+                float dRe = t[2] - t[6], dIm = t[3] - t[7];
+                x[0] = aRe + cRe;
+                x[1] = aIm + cIm;
+                x[s] = bRe + dIm;
+                x[s + 1] = bIm - dRe;
+                x[2 * s] = aRe - cRe;
+                x[2 * s + 1] = aIm - cIm;
+                x[3 * s] = bRe - dIm;
+                x[3 * s + 1] = bIm + dRe;
+            }
+            else {
+                // W_3 = -1/2 - j sqrt(3)/2
+                const float h = 0.866025403784438647f;
+                float sumRe = t[2] + t[4], sumIm = t[3] + t[5];
+                float difRe = h * (t[2] - t[4]), difIm = h * (t[3] - t[5]);
+                float midRe = t[0] - 0.5f * sumRe, midIm = t[1] - 0.5f * sumIm;
+                x[0] = t[0] + sumRe;
+                x[1] = t[1] + sumIm;
+                x[s] = midRe + difIm;
+                x[s + 1] = midIm - difRe;
+                x[2 * s] = midRe - difIm;
+                x[2 * s + 1] = midIm + difRe;
+            }
+        }
+    }
+
+    // c = a (*) kernel, cyclic, from m_work into m_work;
+    // the inverse DFT is the conjugate of the DFT of the conjugate
+    void convolve()
+    {
+        const int n = m_plan.convolutionSize;
+        const float *kernel = m_plan.kernel.data();
+        float *a = m_work.data();
+        float *spectrum = m_spectrum.data();
+
+        m_convolution->execute( a, spectrum );
+        for (int i = 0; i < n; ++i) {
+            float re = spectrum[2 * i] * kernel[2 * i] - spectrum[2 * i + 1] * kernel[2 * i + 1];
+            float im = spectrum[2 * i] * kernel[2 * i + 1] + spectrum[2 * i + 1] * kernel[2 * i];
+            spectrum[2 * i] = re;
+            spectrum[2 * i + 1] = -im;
+        }
+        m_convolution->execute( spectrum, a );
+        for (int i = 0; i < n; ++i)
+            a[2 * i + 1] = -a[2 * i + 1];
+    }
+
+    // X[0] = sum x[n], X[g^-p] = x[0] + sum over q of x[g^q] W_N^(g^(q - p))
+    void rader( const float * in, float * out )
+    {
+        const int n = m_plan.convolutionSize;
+        const int *inputOrder = m_plan.inputOrder.data();
+        const int *outputOrder = m_plan.outputOrder.data();
+        float *a = m_work.data();
+
+        float sumRe = in[0], sumIm = in[1];
+        for (int q = 0; q < n; ++q) {
+            a[2 * q] = in[2 * inputOrder[q]];
+            a[2 * q + 1] = in[2 * inputOrder[q] + 1];
+            sumRe += a[2 * q];
+            sumIm += a[2 * q + 1];
+        }
+
+        convolve();
+
+        out[0] = sumRe;
+        out[1] = sumIm;
+        for (int q = 0; q < n; ++q) {
+            out[2 * outputOrder[q]] = in[0] + a[2 * q];
+            out[2 * outputOrder[q] + 1] = in[1] + a[2 * q + 1];
+        }
+    }
+
+    // X[k] = w[k] sum over n of x[n] w[n] conj w[k - n], w[n] = exp(-j pi n^2 / N)
+    void bluestein( const float * in, float * out )
+    {
+        const int N = m_plan.size;
+        const int n = m_plan.convolutionSize;
+        const float *w = m_plan.chirp.data();
+        float *a = m_work.data();
+
+        for (int i = 0; i < N; ++i) {
+            a[2 * i] = in[2 * i] * w[2 * i] - in[2 * i + 1] * w[2 * i + 1];
+            a[2 * i + 1] = in[2 * i] * w[2 * i + 1] + in[2 * i + 1] * w[2 * i];
+        }
+        for (int i = 2 * N; i < 2 * n; ++i)
+            a[i] = 0.f;
+
+        convolve();
+
+        for (int k = 0; k < N; ++k) {
+            out[2 * k] = a[2 * k] * w[2 * k] - a[2 * k + 1] * w[2 * k + 1];
+            out[2 * k + 1] = a[2 * k] * w[2 * k + 1] + a[2 * k + 1] * w[2 * k];
+        }
+    }
+
+    Plan m_plan;
+    std::unique_ptr<BuiltinDft> m_convolution;
+    std::vector<float> m_work;
+    std::vector<float> m_spectrum;
+};
+
+inline BuiltinDft::Plan::Plan( int n ):
+    size(n),
+    method(MixedRadix),
+    convolutionSize(0)
+{
+    const double pi = Segmenter::pi();
+
+    int rest = n;
+    while (rest % 4 == 0) { factors.push_back(4); rest /= 4; }
+    while (rest % 2 == 0) { factors.push_back(2); rest /= 2; }
+    while (rest % 3 == 0) { factors.push_back(3); rest /= 3; }
+
+    if (rest == 1) {
+        twiddles.resize( 2 * n );
+        for (int i = 0; i < n; ++i) {
+            twiddles[2 * i] = std::cos( 2 * pi * i / n );
+            twiddles[2 * i + 1] = - std::sin( 2 * pi * i / n );
+        }
+        return;
+    }
+
+    bool prime = true;
+    for (int d = 2; d * d <= n; ++d)
+        if (n % d == 0)
+            prime = false;
+
+    // convolution kernel
+    std::vector<float> sequence;
+
+    if (prime)
+    {
+        method = Rader;
+        convolutionSize = n - 1;
+
+        // smallest primitive root g: g^((n - 1) / f) != 1 for all prime factors f of n - 1
+        std::vector<int> primeFactors;
+        for (int f = 2, m = n - 1; m > 1; ++f) {
+            if (m % f == 0) {
+                primeFactors.push_back(f);
+                while (m % f == 0)
+                    m /= f;
+            }
+        }
+        struct Power {
+            static long long mod( long long base, long long exponent, long long modulus )
+            {
+                long long result = 1;
+                for (base %= modulus; exponent; exponent >>= 1, base = base * base % modulus)
+                    if (exponent & 1)
+                        result = result * base % modulus;
+                return result;
+            }
+        };
+        int g = 2;
+        for (;; ++g) {
+            bool primitive = true;
+            for (size_t i = 0; i < primeFactors.size(); ++i)
+                if (Power::mod( g, (n - 1) / primeFactors[i], n ) == 1)
+                    primitive = false;
+            if (primitive)
+                break;
+        }
+        const int gInverse = (int) Power::mod( g, n - 2, n );
+
+        inputOrder.resize( n - 1 );
+        outputOrder.resize( n - 1 );
+        sequence.resize( 2 * (n - 1) );
+        long long forward = 1, backward = 1;
+        for (int q = 0; q < n - 1; ++q) {
+            inputOrder[q] = (int) forward;
+            outputOrder[q] = (int) backward;
+            sequence[2 * q] = std::cos( 2 * pi * backward / n );
+            sequence[2 * q + 1] = - std::sin( 2 * pi * backward / n );
+            forward = forward * g % n;
+            backward = backward * gInverse % n;
+        }
+    }
+    else
+    {
+        method = Bluestein;
+        convolutionSize = 1;
+        while (convolutionSize < 2 * n - 1)
+            convolutionSize *= 2;
+
+        chirp.resize( 2 * n );
+        sequence.assign( 2 * convolutionSize, 0.f );
+        for (int i = 0; i < n; ++i) {
+            // n^2 mod 2N keeps the angle accurate
+            double angle = pi * (double) ((long long) i * i % (2LL * n)) / n;
+            chirp[2 * i] = std::cos(angle);
+            chirp[2 * i + 1] = - std::sin(angle);
+            sequence[2 * i] = std::cos(angle);
+            sequence[2 * i + 1] = std::sin(angle);
+            if (i > 0) {
+                sequence[2 * (convolutionSize - i)] = std::cos(angle);
+                sequence[2 * (convolutionSize - i) + 1] = std::sin(angle);
+            }
+        }
+    }
+
+    // spectrum of the kernel, scaled for the inverse transform
+    kernel.resize( sequence.size() );
+    BuiltinDft dft( convolutionSize );
+    dft.execute( sequence.data(), kernel.data() );
+    for (size_t i = 0; i < kernel.size(); ++i)
+        kernel[i] /= convolutionSize;
+}
+
+/*
+    Real transform of any size N to FFTW's half-complex format (FFTW_R2HC).
+    For even N, as BuiltinRealFft, by a complex DFT of half the size;
+    for odd N, by a complex DFT of the full size.
+*/
+class BuiltinRealDft
+{
+public:
+    struct Plan
+    {
+        int size;
+        // W_N^k for k in [0, N/4], for even N
+        std::vector<float> splitTwiddles;
+
+        explicit Plan( int n ):
+            size(n)
+        {
+            const double pi = Segmenter::pi();
+            if (n % 2 == 0) {
+                splitTwiddles.resize( 2 * (n / 4 + 1) );
+                for (int k = 0; k <= n / 4; ++k) {
+                    splitTwiddles[2 * k] = std::cos( 2 * pi * k / n );
+                    splitTwiddles[2 * k + 1] = - std::sin( 2 * pi * k / n );
+                }
+            }
+        }
+    };
+
+    explicit BuiltinRealDft( int size ):
+        m_plan(size),
+        m_dft( size % 2 == 0 ? size / 2 : size ),
+        m_input( size, 0.f ),
+        m_output( size, 0.f ),
+        m_z( 2 * m_dft.size() ),
+        m_spectrum( 2 * m_dft.size() )
+    {}
+
+    int size() const { return m_plan.size; }
+    float * input() { return m_input.data(); }
+    const float * output() const { return m_output.data(); }
+
+    void execute()
+    {
+        execute( m_input.data(), m_output.data() );
+    }
+
+    void execute( const float * in, float * out )
+    {
+        const int N = m_plan.size;
+        const int M = m_dft.size();
+        float *z = m_z.data();
+        float *spectrum = m_spectrum.data();
+
+        if (N % 2)
+        {
+            for (int i = 0; i < N; ++i) {
+                z[2 * i] = in[i];
+                z[2 * i + 1] = 0.f;
+            }
+            m_dft.execute( z, spectrum );
+            out[0] = spectrum[0];
+            for (int k = 1; k <= N / 2; ++k) {
+                out[k] = spectrum[2 * k];
+                out[N - k] = spectrum[2 * k + 1];
+            }
+            return;
+        }
+
+        // even and odd samples as real and imaginary part
+        std::memcpy( z, in, N * sizeof(float) );
+        m_dft.execute( z, spectrum );
+
+        out[0] = spectrum[0] + spectrum[1];
+        out[M] = spectrum[0] - spectrum[1];
+
+        const float *w = m_plan.splitTwiddles.data();
+        for (int k = 1; k <= M / 2; ++k) {
+            const int l = M - k;
+            const float *a = spectrum + 2 * k;
+            const float *b = spectrum + 2 * l;
+            // E = (Z[k] + conj Z[l]) / 2, O = (Z[k] - conj Z[l]) / 2j
+            float evenRe = 0.5f * (a[0] + b[0]);
+            float evenIm = 0.5f * (a[1] - b[1]);
+            float oddRe = 0.5f * (a[1] + b[1]);
+            float oddIm = - 0.5f * (a[0] - b[0]);
+            float re = oddRe * w[2 * k] - oddIm * w[2 * k + 1];
+            float im = oddRe * w[2 * k + 1] + oddIm * w[2 * k];
+            // X[k] = E + W_N^k O, X[M - k] = conj(E - W_N^k O)
+            out[k] = evenRe + re;
+            out[N - k] = evenIm + im;
+            if (k != l) {
+                out[l] = evenRe - re;
+                out[N - l] = - (evenIm - im);
+            }
+        }
+    }
+
+private:
+    Plan m_plan;
+    BuiltinDft m_dft;
+    std::vector<float> m_input;
+    std::vector<float> m_output;
+    std::vector<float> m_z;
+    std::vector<float> m_spectrum;
+};
+
+/*
+    DCT-II of any size N as FFTW's REDFT10: out[k] = 2 sum x[n] cos(pi k (n + 1/2) / N),
+    by Makhoul's algorithm: the even samples in order followed by the odd ones
+    in reverse, v = (x[0], x[2], ..., x[3], x[1]), have the DFT V with
+
+        out[k] = 2 Re( W_4N^k V[k] ).
+
+    The DFT is the real one of the same size.
+*/
+class BuiltinDct2
+{
+public:
+    struct Plan
+    {
+        int size;
+        // 2 cos(pi k / 2N), 2 sin(pi k / 2N), for k in [0, N)
+        std::vector<float> twiddles;
+
+        explicit Plan( int n ):
+            size(n),
+            twiddles( 2 * n )
+        {
+            const double pi = Segmenter::pi();
+            for (int k = 0; k < n; ++k) {
+                twiddles[2 * k] = 2.0 * std::cos( pi * k / (2.0 * n) );
+                twiddles[2 * k + 1] = 2.0 * std::sin( pi * k / (2.0 * n) );
+            }
+        }
+    };
+
+    explicit BuiltinDct2( int size ):
+        m_plan(size),
+        m_dft( size ),
+        m_input( size, 0.f ),
+        m_output( size, 0.f ),
+        m_v( size ),
+        m_spectrum( size )
+    {}
+
+    int size() const { return m_plan.size; }
+    float * input() { return m_input.data(); }
+    const float * output() const { return m_output.data(); }
+
+    void execute()
+    {
+        const int N = m_plan.size;
+        const float *x = m_input.data();
+        float *v = m_v.data();
+        const float *h = m_spectrum.data();
+        const float *w = m_plan.twiddles.data();
+
+        for (int n = 0; 2 * n < N; ++n)
+            v[n] = x[2 * n];
+        for (int n = 0; 2 * n + 1 < N; ++n)
+            v[N - 1 - n] = x[2 * n + 1];
+
+        m_dft.execute( v, m_spectrum.data() );
+
+        // V[k] = h[k] + j h[N - k] for 0 < k < N/2, and conj V[N - k] above
+        m_output[0] = w[0] * h[0];
+        for (int k = 1; k < N; ++k) {
+            float re, im;
+            if (2 * k < N) {
+                re = h[k];
+                im = h[N - k];
+            }
+            else if (2 * k == N) {
+                re = h[k];
+                im = 0.f;
+            }
+            else {
+                re = h[N - k];
+                im = - h[k];
+            }
+            m_output[k] = w[2 * k] * re + w[2 * k + 1] * im;
+        }
+    }
+
+private:
+    Plan m_plan;
+    BuiltinRealDft m_dft;
+    std::vector<float> m_input;
+    std::vector<float> m_output;
+    std::vector<float> m_v;
+    std::vector<float> m_spectrum;
+};
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_BUILTIN_FFT_HPP_INCLUDED
@@ -22,6 +22,7 @@
 #define SEGMENTER_CEPSTRAL_FEATURES_INCLUDED
 
 #include "module.hpp"
+#include "kernels.hpp"
 
 #include <cmath>
 #include <vector>
@@ -41,7 +42,7 @@ class CepstralFeatures : public Module
     float m_tonality1;
     float m_pitchDensity;
 
-    std::vector<float> m_buffer;
+    static float square( float x ) { return x * x; }
 
 public:
     CepstralFeatures( float sampleRate, int windowSize ):
@@ -84,15 +85,10 @@ public:
 
         int nSpectrum = spectrumMagnitude.size();
 
-        // preprocess spectrum: spectrum = square( max( magnitude, ath ) )
+        // spectrum = square( max( magnitude, ath ) )
         // FIXME: was the 'max' really intentional here, or was simply power spectrum desired??
+        // As this is monotonic in magnitude, it is only applied to the values picked below.
         static const float ath = 1.0f/65536;
-        std::vector<float> & spectrum = m_buffer;
-        spectrum.resize(nSpectrum);
-        for( int i = 0; i < nSpectrum; ++i ) {
-            spectrum[i] = std::max( spectrumMagnitude[i], ath );
-            spectrum[i] *= spectrum[i];
-        }
 
         float sumCeps = 0.f;
         float cepsMax = realCepstrum[m_iMin];
@@ -121,19 +117,17 @@ public:
                 nPartials = iPartial;
                 break;
             }
-            partials[iPartial] = spectrum[iSpectrum];
+            partials[iPartial] = square( std::max( spectrumMagnitude[iSpectrum], ath ) );
         }
 
         // find N highest spectral values
         float highest[5];
-        std::partial_sort_copy( spectrum.begin(), spectrum.end(),
-                                &highest[0], &highest[nPartials],
-                                std::greater<float>() );
+        kernels().largestFive( spectrumMagnitude.data(), nSpectrum, highest );
 
         // sum N heighest spectral values
         float sumHighest = 0.f;
         for (int iHighest = 0; iHighest < nPartials; ++iHighest)
-            sumHighest += highest[iHighest];
+            sumHighest += square( std::max( highest[iHighest], ath ) );
 
         // sum N partials
         float sumPartials = 0.f;
@@ -148,6 +142,12 @@ public:
     float tonality() const { return m_tonality; }
     float tonality1() const { return m_tonality1; }
     float pitchDensity() const { return m_pitchDensity; }
+
+    // Spectrum bins read by process()
+    BinRange inputRange() const { return BinRange(0, m_nWin / 2 + 1); }
+
+    // Cepstrum indices read by process()
+    BinRange cepstrumRange() const { return BinRange(m_iMin, m_iMax); }
 };
 
 } // namespace Segmenter
@@ -19,13 +19,21 @@
 */
 
 #include "classification.hpp"
+#include "classifier_model.hpp"
 
 namespace Segmenter {
 
-const float Classifier::s_coeffs[Classifier::s_inputCount+1][Classifier::s_classCount-1] =
+namespace {
+
+const int s_classCount = 5;
+
+const int s_inputCount = 16;
+
+const char * s_classNames[s_classCount] = { "solo", "choir", "bell", "instrumental", "speech" };
+
+// @  11 Hz:
+const float s_coeffs11kHz[s_inputCount+1][s_classCount-1] =
 {
-    // @  11 Hz:
-    //#if 0
     { 6.300152489, 2.829296423, 3.690354886, 7.675796208 },
     { -3.332328719, 1.111871448, 2.158991290, 1.148274900 },
     { -11.462997304, 8.226234373, 9.745759040, 47.676980822 },
@@ -43,9 +51,11 @@ const float Classifier::s_coeffs[Classifier::s_inputCount+1][Classifier::s_class
     { -0.525794097, -0.229710463, -2.376207770, -1.675524777 },
     { -0.230758491, -1.288575089, -0.483357083, -0.784670070 },
     { 0.372377334, -0.816723558, -2.366902650, -1.944832604 }
-    //#endif
-    // @  44 Hz:
-#if 0
+};
+
+// @  44 Hz:
+const float s_coeffs44kHz[s_inputCount+1][s_classCount-1] =
+{
     { 5.596422778, 4.529101399, 3.908926232, 10.419170917 },
     { -3.135401734, 0.772305736, 1.947714483, 0.670100757 },
     { -12.390062599, -1.553014661, -2.018243139, 28.046459240 },
@@ -63,9 +73,10 @@ const float Classifier::s_coeffs[Classifier::s_inputCount+1][Classifier::s_class
     { -0.239473985, -0.217124454, -2.449646233, -1.749341781 },
     { -0.497556435, -1.522606470, -0.522296618, -0.906182378 },
     { -0.087351009, -1.016509524, -2.569043250, -2.358299398 }
-#endif
+};
 
-#if 0
+const float s_coeffsAlternative[s_inputCount+1][s_classCount-1] =
+{
     { 7.2167803598f, 6.7546674784f,  2.4266379892f, -2.4717760029f },
     { -3.5872281700f, 0.6072347911f, 1.8414028714f, 2.2034845670f },
     { -3.6282955710f, 4.0023822690f, 24.5460436473f, 9.8999564256f },
@@ -83,10 +94,10 @@ const float Classifier::s_coeffs[Classifier::s_inputCount+1][Classifier::s_class
     { -0.7064083607f, -0.3722998341f, -3.3327763422f, -3.2676743146f },
     { 0.0810537624f, -0.9897814477f, -0.1841711166f, 0.1095410510f },
     { -0.2802757255f, -1.3975128828f, -4.3334540597f, -1.7647213147f },
-#endif
 };
 
-/* Coefficients for old set of features:
+// Coefficients for old set of features:
+const float s_coeffsOldFeatures[10][s_classCount-1] =
 {
     {-2.54360f,   1.20630f,   1.25340f,   1.02670f},
     {0.01410f,   0.01860f,   0.00570f,   0.02100f},
@@ -99,6 +110,36 @@ const float Classifier::s_coeffs[Classifier::s_inputCount+1][Classifier::s_class
     {-0.40990f,  -1.52120f,   -1.16710f, -0.98170f},
     {9.72240f, -0.61690f,     10.70270f,   2.26640f}
 };
-*/
+
+std::shared_ptr<const ClassifierModel> makeModel( int inputCount, const float * coefficients )
+{
+    std::vector<std::string> classNames( s_classNames, s_classNames + s_classCount );
+    return std::shared_ptr<const ClassifierModel>
+            ( new ClassifierModel( inputCount, classNames, coefficients ) );
+}
+
+}
+
+std::shared_ptr<const ClassifierModel> ClassifierModel::builtin( Builtin model )
+{
+    static const std::shared_ptr<const ClassifierModel> models[BuiltinModelCount] = {
+        makeModel( s_inputCount, s_coeffs11kHz[0] ),
+        makeModel( s_inputCount, s_coeffs44kHz[0] ),
+        makeModel( s_inputCount, s_coeffsAlternative[0] ),
+        makeModel( 9, s_coeffsOldFeatures[0] )
+    };
+    return models[model];
+}
+
+const char * ClassifierModel::builtinFileName( Builtin model )
+{
+    static const char * names[BuiltinModelCount] = {
+        "default-11khz.segmodel",
+        "analysis-44khz.segmodel",
+        "alternative.segmodel",
+        "old-features.segmodel"
+    };
+    return names[model];
+}
 
 } // namespace Segmenter
@@ -22,9 +22,12 @@
 #define SEGMENTER_CLASSIFICATION_HPP_INCLUDED
 
 #include "module.hpp"
+#include "kernels.hpp"
+#include "classifier_model.hpp"
 
 #include <vector>
 #include <string>
+#include <memory>
 #include <cmath>
 #include <iostream>
 
@@ -32,43 +35,92 @@ namespace Segmenter {
 
 class Classifier : public Module
 {
-    static const int s_classCount = 5;
-
-    static const int s_inputCount = 16;
-
-    static const float s_coeffs[s_inputCount+1][s_classCount-1];
+    std::shared_ptr<const ClassifierModel> m_model;
+    int m_classCount;
 
+    std::vector<float> m_logits;
+    std::vector<float> m_exp;
     std::vector<float> m_output;
-    std::vector< std::string > m_classNames;
+
+    MathContext::Precision m_precision;
 
 public:
-    Classifier()
+    Classifier( MathContext::Precision precision = MathContext::Accurate,
+                const std::shared_ptr<const ClassifierModel> & model = ClassifierModel::builtin() ):
+        m_model(model),
+        m_classCount(model->classCount()),
+        m_precision(precision)
+    {
+        m_output.resize(m_classCount);
+    }
+
+    // Replaces the model, also while another thread is in process();
+    // the next call to process() uses the new one.
+    void setModel( const std::shared_ptr<const ClassifierModel> & model )
     {
-        m_output.resize(s_classCount);
-        std::string classNames[] = { "solo", "choir", "bell", "instrumental", "speech" };
-        m_classNames.insert( m_classNames.end(), &classNames[0], &classNames[5] );
+        std::atomic_store( &m_model, model );
     }
 
+    std::shared_ptr<const ClassifierModel> model() const { return std::atomic_load( &m_model ); }
+
     void process( const float * input )
     {
-        float *t = m_output.data();
-        float sum = 1;
-        for (int nJ = 0; nJ < s_classCount - 1; nJ++)
+        process( input, 0, 1 );
+    }
+
+    // Computes probabilities of a block of 'rows' inputs,
+    // the first 'inputStride' floats apart.
+    void process( const float * input, int inputStride, int rows )
+    {
+        // the model stays alive until the end of the call, even if replaced meanwhile
+        const std::shared_ptr<const ClassifierModel> model = std::atomic_load( &m_model );
+        const int inputCount = model->inputCount();
+        const int logitCount = model->classCount() - 1;
+        const int logitStride = model->panelCount() * ClassifierModel::panelWidth;
+        const float *constants = model->constants();
+
+        m_classCount = model->classCount();
+        m_logits.resize(rows * logitStride);
+        m_exp.resize(rows * logitCount);
+        m_output.resize(rows * m_classCount);
+
+        if (!rows)
+            return;
+
+        for (int panel = 0; panel < model->panelCount(); ++panel)
+            kernels().filterPanel( input, inputStride, rows,
+                                   model->panel(panel), inputCount,
+                                   m_logits.data() + panel * ClassifierModel::panelWidth, logitStride );
+
+        float *t = m_exp.data();
+        for (int r = 0; r < rows; ++r)
+            for (int nJ = 0; nJ < logitCount; nJ++)
+                t[r * logitCount + nJ] = m_logits[r * logitStride + nJ] + constants[nJ];
+
+        if (m_precision == MathContext::Fast)
+            kernels().fastExp( t, t, rows * logitCount );
+        else
+            for (int i = 0; i < rows * logitCount; i++)
+                t[i] = std::exp( t[i] );
+
+        float *p = m_output.data();
+        for (int r = 0; r < rows; ++r, t += logitCount, p += m_classCount)
         {
-            t[nJ] = 0;
-            int nK;
-            for (nK = 0; nK < s_inputCount; nK++)
-                t[nJ] += s_coeffs[nK+1][nJ] * input[nK];
-            t[nJ] = std::exp( t[nJ] + s_coeffs[0][nJ] );
-            sum += t[nJ];
+            float sum = 1;
+            for (int nJ = 0; nJ < logitCount; nJ++)
+                sum += t[nJ];
+            for (int nJ = 0; nJ < logitCount; nJ++)
+                p[nJ] = t[nJ] / sum;
+            p[logitCount] = 1/sum;
         }
-        for (int nJ = 0; nJ < s_classCount - 1; nJ++)
-            t[nJ] /= sum;
-        t[s_classCount - 1] = 1/sum;
     }
 
-    const std::vector< std::string > & classNames() { return m_classNames; }
+    // Classes of the last call to process()
+    int classCount() const { return m_classCount; }
+
+    std::vector< std::string > classNames() const { return model()->classNames(); }
 
+    // Probabilities of each class, for each input of the last call to process()
     const std::vector<float> & probabilities() { return m_output; }
 };
 
@@ -0,0 +1,200 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "classifier_model.hpp"
+
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Segmenter {
+
+namespace {
+
+const char s_magic[8] = { 'S', 'E', 'G', 'M', 'O', 'D', 'L', 1 };
+
+const int s_dataAlignment = 64;
+
+// Written in the byte order of the host; files of the other order are rejected
+const uint32_t s_byteOrderMark = 0x01020304;
+
+// Upper bound of input and class counts accepted from files
+const int32_t s_maxCount = 1 << 16;
+
+}
+
+ClassifierModel::ClassifierModel():
+    m_inputCount(0),
+    m_data(0),
+    m_mapping(0),
+    m_mappingSize(0)
+{}
+
+ClassifierModel::ClassifierModel( int inputCount, const std::vector<std::string> & classNames,
+                                  const float * coefficients ):
+    m_inputCount(inputCount),
+    m_classNames(classNames),
+    m_mapping(0),
+    m_mappingSize(0)
+{
+    const int logitCount = classCount() - 1;
+    m_storage.assign( dataSize(), 0.f );
+    for (int j = 0; j < logitCount; ++j)
+        m_storage[j] = coefficients[j];
+    for (int k = 0; k < inputCount; ++k) {
+        for (int j = 0; j < logitCount; ++j) {
+            int offset = (panelCount() + (j / panelWidth) * inputCount + k) * panelWidth + j % panelWidth;
+            m_storage[offset] = coefficients[(k + 1) * logitCount + j];
+        }
+    }
+    m_data = m_storage.data();
+}
+
+ClassifierModel::~ClassifierModel()
+{
+#ifndef _WIN32
+    if (m_mapping)
+        munmap( m_mapping, m_mappingSize );
+#endif
+}
+
+float ClassifierModel::coefficient( int row, int logit ) const
+{
+    if (row == 0)
+        return constants()[logit];
+    return panel( logit / panelWidth )[(row - 1) * panelWidth + logit % panelWidth];
+}
+
+std::shared_ptr<const ClassifierModel> ClassifierModel::load( const std::string & filename )
+{
+    std::shared_ptr<ClassifierModel> model( new ClassifierModel );
+
+    const char * bytes = 0;
+    size_t size = 0;
+
+#ifdef _WIN32
+    std::ifstream in( filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate );
+    if (!in.is_open())
+        return std::shared_ptr<const ClassifierModel>();
+    size = in.tellg();
+    in.seekg( 0 );
+    model->m_storage.resize( (size + sizeof(float) - 1) / sizeof(float) );
+    in.read( reinterpret_cast<char*>(model->m_storage.data()), size );
+    if (!in)
+        return std::shared_ptr<const ClassifierModel>();
+    bytes = reinterpret_cast<const char*>(model->m_storage.data());
+#else
+    int file = open( filename.c_str(), O_RDONLY );
+    if (file < 0)
+        return std::shared_ptr<const ClassifierModel>();
+    struct stat status;
+    if (fstat( file, &status ) == 0 && status.st_size > 0) {
+        size = status.st_size;
+        void * mapping = mmap( 0, size, PROT_READ, MAP_PRIVATE, file, 0 );
+        if (mapping != MAP_FAILED) {
+            model->m_mapping = mapping;
+            model->m_mappingSize = size;
+        }
+    }
+    close( file );
+    if (!model->m_mapping)
+        return std::shared_ptr<const ClassifierModel>();
+    bytes = static_cast<const char*>(model->m_mapping);
+#endif
+
+    FileHeader header;
+    if (size < sizeof(header))
+        return std::shared_ptr<const ClassifierModel>();
+    std::memcpy( &header, bytes, sizeof(header) );
+
+    if (std::memcmp( header.magic, s_magic, sizeof(s_magic) ) != 0
+            || header.byteOrder != s_byteOrderMark
+            || header.inputCount < 1 || header.inputCount > s_maxCount
+            || header.classCount < 2 || header.classCount > s_maxCount
+            || header.panelWidth != panelWidth
+            || header.namesSize < 0 || header.dataOffset < 0
+            || header.dataOffset % s_dataAlignment != 0)
+        return std::shared_ptr<const ClassifierModel>();
+
+    // names and coefficients must lie within the file
+    const uint64_t namesEndOffset = (uint64_t) sizeof(header) + (uint64_t) header.namesSize;
+    const uint64_t panels = ((uint64_t) header.classCount - 1 + panelWidth - 1) / panelWidth;
+    const uint64_t dataBytes = panels * panelWidth * (1 + (uint64_t) header.inputCount) * sizeof(float);
+    if (namesEndOffset > (uint64_t) header.dataOffset
+            || (uint64_t) header.dataOffset + dataBytes > (uint64_t) size)
+        return std::shared_ptr<const ClassifierModel>();
+
+    const char * name = bytes + sizeof(header);
+    const char * namesEnd = name + header.namesSize;
+    while (name < namesEnd) {
+        const char * end = static_cast<const char*>( std::memchr( name, 0, namesEnd - name ) );
+        if (!end)
+            return std::shared_ptr<const ClassifierModel>();
+        model->m_classNames.push_back( std::string(name, end) );
+        name = end + 1;
+    }
+
+    model->m_inputCount = header.inputCount;
+    if (model->classCount() != header.classCount)
+        return std::shared_ptr<const ClassifierModel>();
+
+    model->m_data = reinterpret_cast<const float*>( bytes + header.dataOffset );
+    return model;
+}
+
+bool ClassifierModel::save( const std::string & filename ) const
+{
+    std::ofstream out( filename.c_str(), std::ios::out | std::ios::binary );
+    if (!out.is_open())
+        return false;
+
+    std::string names;
+    for (int c = 0; c < classCount(); ++c) {
+        names += m_classNames[c];
+        names += '\0';
+    }
+
+    FileHeader header;
+    std::memcpy( header.magic, s_magic, sizeof(s_magic) );
+    header.byteOrder = s_byteOrderMark;
+    header.inputCount = m_inputCount;
+    header.classCount = classCount();
+    header.panelWidth = panelWidth;
+    header.namesSize = names.size();
+    header.dataOffset = (sizeof(header) + names.size() + s_dataAlignment - 1)
+            / s_dataAlignment * s_dataAlignment;
+
+    out.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+    out.write( names.data(), names.size() );
+    out.write( std::string( header.dataOffset - sizeof(header) - names.size(), '\0' ).data(),
+               header.dataOffset - sizeof(header) - names.size() );
+    out.write( reinterpret_cast<const char*>(m_data), dataSize() * sizeof(float) );
+
+    return (bool) out;
+}
+
+} // namespace Segmenter
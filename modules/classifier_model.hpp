@@ -0,0 +1,136 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_CLASSIFIER_MODEL_HPP_INCLUDED
+#define SEGMENTER_CLASSIFIER_MODEL_HPP_INCLUDED
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Segmenter {
+
+/*
+    Coefficients of the multinomial logistic regression of Classifier.
+
+    The logit of each class but the last is a constant plus a weighted sum
+    of the inputs; the last class is the reference, with a logit of zero.
+
+    Coefficients are laid out as used by Kernels::filterPanel: the constants,
+    then one panel of 'panelWidth' columns after another, each holding a row
+    for every input; columns past the last logit are zero.
+    Model files hold the same layout, aligned to 64 bytes, and are mapped
+    into memory as they are:
+
+        char    magic[8]        "SEGMODL" 1
+        uint32  byteOrder       0x01020304
+        int32   inputCount
+        int32   classCount
+        int32   panelWidth
+        int32   namesSize       bytes of class names, each terminated by 0
+        int32   dataOffset      of the coefficients, a multiple of 64
+        char    names[namesSize]
+        float   constants[panelCount * panelWidth]      at dataOffset
+        float   panels[panelCount][inputCount][panelWidth]
+
+    Numbers are in the byte order of the host writing the file; load()
+    rejects files of the other order by the byteOrder field.
+*/
+class ClassifierModel
+{
+public:
+    static const int panelWidth = 8;
+
+    // Start of model files, before the class names
+    struct FileHeader {
+        char magic[8];
+        uint32_t byteOrder;
+        int32_t inputCount;
+        int32_t classCount;
+        int32_t panelWidth;
+        int32_t namesSize;
+        int32_t dataOffset;
+    };
+
+    enum Builtin {
+        // 11025 Hz analysis, the default
+        Default11kHzModel,
+        // 44100 Hz analysis
+        Analysis44kHzModel,
+        // Earlier fit of the current features
+        AlternativeModel,
+        // Old set of 9 features, not computed by Statistics any more
+        OldFeaturesModel,
+
+        BuiltinModelCount
+    };
+
+    // Row 0 of 'coefficients' holds the constants, row k + 1 the weights of input k,
+    // each row one column for each class but the last.
+    ClassifierModel( int inputCount, const std::vector<std::string> & classNames,
+                     const float * coefficients );
+    ~ClassifierModel();
+
+    // Returns 0 if the file can not be read or is not a valid model
+    static std::shared_ptr<const ClassifierModel> load( const std::string & filename );
+    bool save( const std::string & filename ) const;
+
+    // Models compiled into the library
+    static std::shared_ptr<const ClassifierModel> builtin( Builtin model = Default11kHzModel );
+    // File name of the bundled file of a builtin model
+    static const char * builtinFileName( Builtin model );
+
+    int inputCount() const { return m_inputCount; }
+    int classCount() const { return (int) m_classNames.size(); }
+    const std::vector<std::string> & classNames() const { return m_classNames; }
+
+    int panelCount() const { return (classCount() - 1 + panelWidth - 1) / panelWidth; }
+    // panelCount() * panelWidth constants
+    const float * constants() const { return m_data; }
+    // inputCount() rows of panelWidth weights
+    const float * panel( int index ) const
+    { return m_data + (panelCount() + index * m_inputCount) * panelWidth; }
+
+    // Constant (row 0) or weight of input row - 1, of the logit of a class
+    float coefficient( int row, int logit ) const;
+
+    // Whether the coefficients are mapped from a file
+    bool isMapped() const { return m_mapping != 0; }
+
+private:
+    ClassifierModel();
+    ClassifierModel( const ClassifierModel & );
+    ClassifierModel & operator=( const ClassifierModel & );
+
+    int dataSize() const { return panelCount() * panelWidth * (1 + m_inputCount); }
+
+    int m_inputCount;
+    std::vector<std::string> m_classNames;
+    std::vector<float> m_storage;
+    const float * m_data;
+    void * m_mapping;
+    size_t m_mappingSize;
+};
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_CLASSIFIER_MODEL_HPP_INCLUDED
@@ -0,0 +1,107 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_DELTA_FILTER_HPP_INCLUDED
+#define SEGMENTER_DELTA_FILTER_HPP_INCLUDED
+
+#include "kernels.hpp"
+
+#include <vector>
+#include <algorithm>
+
+namespace Segmenter {
+
+/*
+    Deltas of feature columns by linear regression over 'filterLen' frames,
+    and deltas of those deltas up to 'order'.
+
+    process() takes a batch of consecutive frames of any number of columns,
+    and filters each column once per order with the fir kernel.
+    A delta of order r at a frame reads inputs r * halfLength() frames
+    before and after it.
+*/
+class DeltaFilter
+{
+    std::vector<float> m_taps;
+    int m_order;
+    std::vector<float> m_scratch;
+
+public:
+    DeltaFilter( int filterLen = 5, int order = 1 ):
+        m_taps( taps(filterLen) ),
+        m_order( std::max(order, 1) )
+    {}
+
+    // Regression weights of 'filterLen' (rounded down to odd) frames
+    static std::vector<float> taps( int filterLen )
+    {
+        int halfFilterLen = (filterLen - 1) / 2;
+        std::vector<float> filter(2 * halfFilterLen + 1);
+        float sum = 0;
+        for (int i = -halfFilterLen; i <= halfFilterLen; ++i)
+            sum += i*i;
+        for (int i = -halfFilterLen; i <= halfFilterLen; ++i)
+            filter[ halfFilterLen + i ] = i / sum;
+        return filter;
+    }
+
+    const std::vector<float> & taps() const { return m_taps; }
+    int length() const { return m_taps.size(); }
+    int halfLength() const { return m_taps.size() / 2; }
+    int order() const { return m_order; }
+
+    // Input frames needed before and after the frames of a batch
+    int margin() const { return m_order * halfLength(); }
+
+    /*
+        For each of 'columns' inputs of count + 2 * margin() frames,
+        writes the deltas of order r in [1, order()] of the 'count' frames
+        following the first margin() ones, to outputs[(r - 1) * columns + c].
+    */
+    void process( const float * const *inputs, int columns, int count, float * const *outputs )
+    {
+        const Kernels & k = kernels();
+        const int half = halfLength();
+        const int stride = count + 2 * margin();
+        if (m_order > 1)
+            m_scratch.resize( 2 * stride );
+
+        for (int c = 0; c < columns; ++c) {
+            const float *input = inputs[c];
+            for (int r = 1; r <= m_order; ++r) {
+                float *output = outputs[(r - 1) * columns + c];
+                if (r == m_order) {
+                    k.fir( input, m_taps.data(), m_taps.size(), output, count );
+                    break;
+                }
+                // deltas of order r, as far as the next order reads them
+                const int extra = (m_order - r) * half;
+                float *delta = m_scratch.data() + (r % 2) * stride;
+                k.fir( input, m_taps.data(), m_taps.size(), delta, count + 2 * extra );
+                std::copy( delta + extra, delta + extra + count, output );
+                input = delta;
+            }
+        }
+    }
+};
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_DELTA_FILTER_HPP_INCLUDED
@@ -22,31 +22,135 @@
 #define SEGMENTER_ENERGY_HPP_INCLUDED
 
 #include "module.hpp"
+#include "kernels.hpp"
+#include "spectrum.hpp"
 
 #include <vector>
+#include <algorithm>
 
 namespace Segmenter {
 
+/*
+    Mean square of a block.
+
+    Given a hop size, process() takes consecutive blocks 'hopSize' samples
+    apart, and sums the squares of each segment of gcd(windowSize, hopSize)
+    samples only once: segments shared with the previous block are reused.
+    The output is summed from the segment sums of each block anew,
+    so it does not drift as a running sum would.
+*/
 class Energy : public Module
 {
     int m_windowSize;
+    int m_hopSize;
+    int m_segmentSize;
+    // Sums of squares of the segments of the last block, in order
+    std::vector<float> m_segmentSums;
+    bool m_hasPrevious;
     float m_output;
 
 public:
-    Energy( int windowSize ):
+    Energy( int windowSize, int hopSize = 0 ):
         m_windowSize(windowSize),
+        m_hopSize(hopSize),
+        m_segmentSize(windowSize),
+        m_hasPrevious(false),
         m_output(0.f)
-    {}
+    {
+        if (hopSize > 0)
+            m_segmentSize = gcd( windowSize, hopSize );
+        m_segmentSums.resize( windowSize / m_segmentSize, 0.f );
+    }
 
     void process ( const float *samples )
     {
-        m_output = 0.f;
-        for (int i = 0; i < m_windowSize; ++i)
-            m_output += samples[i] * samples[i];
-        m_output = m_output / m_windowSize;
+        const int segmentCount = m_segmentSums.size();
+        const int hopSegments = m_hopSize / m_segmentSize;
+
+        // Segments of this block already summed for the previous one
+        int kept = 0;
+        if (m_hasPrevious && hopSegments < segmentCount) {
+            kept = segmentCount - hopSegments;
+            std::copy( m_segmentSums.begin() + hopSegments, m_segmentSums.end(),
+                       m_segmentSums.begin() );
+        }
+
+        const Kernels & k = kernels();
+        for (int segment = kept; segment < segmentCount; ++segment)
+            m_segmentSums[segment] = k.sumOfSquares( samples + segment * m_segmentSize, m_segmentSize );
+
+        double sum = 0.0;
+        for (int segment = 0; segment < segmentCount; ++segment)
+            sum += m_segmentSums[segment];
+
+        m_output = sum / m_windowSize;
+        m_hasPrevious = m_hopSize > 0;
+    }
+
+    // Makes the next process() start from a block unrelated to the last one
+    void reset() { m_hasPrevious = false; }
+
+    float output() const { return m_output; }
+
+    // Sums of squares of the consecutive segments of the last block,
+    // each segmentSize() samples long
+    const std::vector<float> & segmentSums() const { return m_segmentSums; }
+    int segmentSize() const { return m_segmentSize; }
+
+private:
+    static int gcd( int a, int b )
+    {
+        while (b) {
+            int r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+};
+
+/*
+    Mean square of a block, estimated from the low 'binCount' bins of its
+    power spectrum by Parseval's theorem, and corrected for the window.
+
+    For a block sampled at a higher rate than the analysis rate, this is
+    the energy the block would have after low-pass filtering and
+    resampling, with the last bin taking the role of the Nyquist bin.
+*/
+class SpectralEnergy : public Module
+{
+    int m_binCount;
+    float m_scale;
+    float m_output;
+
+public:
+    SpectralEnergy( const PowerSpectrum & spectrum, int binCount ):
+        m_binCount(binCount),
+        m_output(0.f)
+    {
+        const int windowSize = spectrum.windowSize();
+        const float *window = spectrum.window();
+
+        double sumSquares = 0.0;
+        for (int idx = 0; idx < windowSize; ++idx)
+            sumSquares += window[idx] * window[idx];
+
+        // sum(x^2) = 1/N sum(|X|^2), over both halves of the spectrum
+        m_scale = 1.0 / (spectrum.outputScale() * windowSize * sumSquares);
+    }
+
+    void process( const float *power )
+    {
+        double sum = power[0] + power[m_binCount - 1];
+        for (int bin = 1; bin < m_binCount - 1; ++bin)
+            sum += 2.0 * power[bin];
+        m_output = sum * m_scale;
     }
 
     float output() const { return m_output; }
+
+    // Spectrum bins read by process()
+    BinRange inputRange() const { return BinRange(0, m_binCount); }
 };
 
 } // namespace Segmenter
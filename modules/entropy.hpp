@@ -22,50 +22,74 @@
 #define SEGMENTER_SPECTRAL_ENTROPY_HPP_INCLUDED
 
 #include "module.hpp"
+#include "filter_bank.hpp"
+#include "kernels.hpp"
+#include "tables.hpp"
 
 #include <vector>
 #include <list>
 #include <cmath>
+#include <limits>
 
 namespace Segmenter {
 
 class ChromaticEntropy : public Module
 {
-    struct Filter {
-        int offset;
-        std::vector<float> coeffs;
-    };
-
-    std::vector<Filter> m_melFilters;
-    std::vector<float> m_melFreqs;
+    std::shared_ptr<const Tables::ChromaticFilters> m_filters;
     std::vector<float> m_melSpectrum;
+    std::vector<float> m_buffer;
     float m_output;
 
+    MathContext::Precision m_precision;
+
 public:
-    ChromaticEntropy( int sampleRate, int windowSize, int loFreq = 55, int hiFreq = 2200 )
+    ChromaticEntropy( int sampleRate, int windowSize, int loFreq = 55, int hiFreq = 2200,
+                      MathContext::Precision precision = MathContext::Accurate ):
+        m_precision(precision)
     {
-        initFilter(loFreq, hiFreq, sampleRate, windowSize);
-        m_melSpectrum.resize( m_melFilters.size() );
+        m_filters = Tables::chromaticFilterBank( loFreq, hiFreq, sampleRate, windowSize / 2 + 1 );
+        m_melSpectrum.resize( filterBank().filterCount() );
+        m_buffer.resize( 2 * filterBank().filterCount() );
     }
 
     void process( const std::vector<float> & spectrum )
     {
-        const int melBinCount = m_melFilters.size();
+        filterBank().process( spectrum.data(), m_melSpectrum.data() );
+        processFiltered( m_melSpectrum.data() );
+    }
+
+    // Takes the output of filterBank(), applied elsewhere.
+    void processFiltered( const float * melSpectrum )
+    {
+        const int melBinCount = m_melSpectrum.size();
 
         float sum = 0;
         for (int melBin = 0; melBin < melBinCount; ++melBin)
         {
-            const Filter & filter = m_melFilters[melBin];
-            const int filterSize = filter.coeffs.size();
-
-            float melPower = 0.f;
-            for (int bin = 0; bin < filterSize; ++bin)
-                melPower += spectrum[bin + filter.offset] * filter.coeffs[bin];
-
+            float melPower = melSpectrum[melBin];
             sum += melPower;
             m_melSpectrum[melBin] = melPower;
         }
 
+        if (m_precision == MathContext::Fast)
+            m_output = fastEntropy( m_melSpectrum.data(), melBinCount, sum, m_buffer.data() );
+        else
+            m_output = entropy( m_melSpectrum.data(), melBinCount, sum );
+    }
+
+    float output() const { return m_output; }
+
+    const std::vector<float> melSpectrum() { return m_melSpectrum; }
+    const std::vector<float> melFrequencies() { return m_filters->frequencies; }
+    int melBinCount() { return m_melSpectrum.size(); }
+
+    const SparseFilterBank & filterBank() const { return m_filters->filterBank; }
+
+    // Spectrum bins read by process()
+    BinRange inputRange() const { return filterBank().inputRange(); }
+
+    static float entropy( const float * melSpectrum, int melBinCount, float sum )
+    {
         float entropy = 0;
         if (sum != 0)
         {
@@ -73,25 +97,36 @@ public:
 
             for (int melBin = 0; melBin < melBinCount; ++melBin)
             {
-                float power = m_melSpectrum[melBin];
+                float power = melSpectrum[melBin];
                 power /= sum;
                 if (power != 0)
                     entropy += power * std::log(power) * oneOverLog2;
             }
             entropy *= -1;
         }
-
-        m_output = entropy;
+        return entropy;
     }
 
-    float output() const { return m_output; }
-
-    const std::vector<float> melSpectrum() { return m_melSpectrum; }
-    const std::vector<float> melFrequencies() { return m_melFreqs; }
-    int melBinCount() { return m_melSpectrum.size(); }
+    // As entropy(), using Kernels::fastLog;
+    // 'buffer' holds 2 * melBinCount elements.
+    static float fastEntropy( const float * melSpectrum, int melBinCount, float sum, float * buffer )
+    {
+        if (sum == 0)
+            return 0;
+
+        static const float oneOverLog2 = 1.0 / std::log(2.0);
+        const Kernels & k = kernels();
+        float *power = buffer;
+        float *logPower = buffer + melBinCount;
+
+        // Zero power gives 0 * log(FLT_MIN) = 0, as skipped by entropy()
+        k.scale( 1.f / sum, melSpectrum, power, melBinCount );
+        k.fastLog( power, std::numeric_limits<float>::min(), logPower, melBinCount );
+        return - k.dot( power, logPower, melBinCount ) * oneOverLog2;
+    }
 
-private:
-    void initFilter( int loFreq, int hiFreq, int sampleRate, int windowSize )
+    static void initFilter( int loFreq, int hiFreq, float sampleRate, int spectrumSize,
+                            SparseFilterBank & filterBank, std::vector<float> & melFrequencies )
     {
         std::vector<float> freqs;
         freqs.reserve(100);
@@ -101,8 +136,7 @@ private:
             freqs.push_back( loFreq * std::pow( 2.0, (double) idx / 12 ) );
 
         int nFreqs = freqs.size() - 2;
-        //int nSpecSize = std::ceil( (windowSize + 1.0) / 2 );
-        int nSpecSize = windowSize / 2 + 1;
+        int nSpecSize = spectrumSize;
 
         float * triangleHeight = new float[nFreqs];
         for (int idx = 0; idx < nFreqs; idx++)
@@ -110,36 +144,37 @@ private:
 
         float * fft_freq = new float[nSpecSize];
         for (int idx = 0; idx < nSpecSize - 1; idx++)
-            fft_freq[idx] = idx * (float)sampleRate / 2 / (nSpecSize - 1);
-        fft_freq[nSpecSize - 1] = (float)sampleRate / 2;
+            fft_freq[idx] = idx * sampleRate / 2 / (nSpecSize - 1);
+        fft_freq[nSpecSize - 1] = sampleRate / 2;
 
-        m_melFilters.reserve(nFreqs);
+        filterBank = SparseFilterBank( nSpecSize );
 
+        std::vector<float> coeffs;
         for (int i = 0; i < nFreqs; i++)
         {
-            Filter filter;
-            filter.offset = -1;
+            int offset = -1;
+            coeffs.clear();
             for (int j = 0; j < nSpecSize - 1; j++)
             {
                 if (fft_freq[j] > freqs[i] && fft_freq[j] <= freqs[i + 1])
                 {
-                    filter.offset = (filter.offset == -1 ? j : filter.offset);
-                    filter.coeffs.push_back(
+                    offset = (offset == -1 ? j : offset);
+                    coeffs.push_back(
                         triangleHeight[i] * (fft_freq[j] - freqs[i]) / (freqs[i + 1] - freqs[i])
                     );
                 }
                 else if (fft_freq[j] > freqs[i + 1] && fft_freq[j] < freqs[i + 2])
                 {
-                    filter.offset = (filter.offset == -1 ? j : filter.offset);
-                    filter.coeffs.push_back(
+                    offset = (offset == -1 ? j : offset);
+                    coeffs.push_back(
                         triangleHeight[i] * (freqs[i + 2] - fft_freq[j]) / (freqs[i + 2] - freqs[i + 1])
                     );
                 }
             }
-            m_melFilters.push_back(filter);
+            filterBank.addFilter( offset, coeffs.data(), coeffs.size() );
         }
 
-        m_melFreqs = freqs;
+        melFrequencies = freqs;
 
         delete[] triangleHeight;
         delete[] fft_freq;
@@ -149,4 +184,3 @@ private:
 } // namespace Segmenter
 
 #endif // SEGMENTER_SPECTRAL_ENTROPY_HPP_INCLUDED
-
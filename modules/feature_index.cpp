@@ -0,0 +1,239 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "feature_index.hpp"
+#include "delta_filter.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+namespace Segmenter {
+
+namespace {
+
+const char s_magic[8] = { 'S', 'E', 'G', 'F', 'I', 'D', 'X', 1 };
+
+// Input feature of each delta column
+const Statistics::InputFeature s_deltaInputs[] = {
+    Statistics::ENTROPY,
+    Statistics::MFCC2,
+    Statistics::MFCC3,
+    Statistics::MFCC4
+};
+
+void write( std::ostream & out, const std::vector<double> & values )
+{
+    int32_t size = values.size();
+    out.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+    out.write( reinterpret_cast<const char*>(values.data()), size * sizeof(double) );
+}
+
+// Reads values written by write(), of at most the bytes left before 'end'
+bool read( std::istream & in, std::vector<double> & values, std::streamoff end )
+{
+    int32_t size = 0;
+    in.read( reinterpret_cast<char*>(&size), sizeof(size) );
+    if (!in || size < 1 || (int64_t) size * (int64_t) sizeof(double) > end - in.tellg())
+        return false;
+    values.resize( size );
+    in.read( reinterpret_cast<char*>(values.data()), size * sizeof(double) );
+    return (bool) in;
+}
+
+}
+
+FeatureIndex::FeatureIndex( double frameRate, int deltaWindowSize ):
+    m_frameRate(frameRate),
+    m_deltaFilter( DeltaFilter::taps(deltaWindowSize) ),
+    m_halfFilterLen( m_deltaFilter.size() / 2 ),
+    m_finished(false),
+    m_count( 1, 0.0 )
+{
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        m_sum[c].assign( 1, 0.0 );
+        m_sumOfSquares[c].assign( 1, 0.0 );
+        m_shift[c] = 0.0;
+        m_hasShift[c] = false;
+    }
+}
+
+void FeatureIndex::append( const Statistics::InputFeatures * frames, int count )
+{
+    if (m_finished) {
+        std::cout << "*** WARNING: FeatureIndex: can not append to a finished index." << std::endl;
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const Statistics::InputFeatures & input = frames[i];
+        const bool gated = input[Statistics::ENERGY_GATE] == 1.f;
+
+        m_count.push_back( m_count.back() + (gated ? 1.0 : 0.0) );
+        for (int c = 0; c < Statistics::INPUT_FEATURE_COUNT; ++c)
+            accumulate( c, input.data[c], gated );
+
+        m_gates.push_back( gated );
+        for (int d = 0; d < DELTA_FEATURE_COUNT; ++d)
+            m_deltaInputs[d].push_back( input[s_deltaInputs[d]] );
+
+        // deltas of frames with all of their following filter inputs
+        int frame = m_sum[ENTROPY_DELTA].size() - 1;
+        for (; frame + m_halfFilterLen < frameCount(); ++frame)
+            appendDelta( frame );
+    }
+}
+
+void FeatureIndex::finish()
+{
+    if (m_finished)
+        return;
+
+    for (int frame = m_sum[ENTROPY_DELTA].size() - 1; frame < frameCount(); ++frame)
+        appendDelta( frame );
+
+    m_finished = true;
+}
+
+void FeatureIndex::appendDelta( int frame )
+{
+    const int last = frameCount() - 1;
+    const int filterSize = m_deltaFilter.size();
+
+    for (int d = 0; d < DELTA_FEATURE_COUNT; ++d) {
+        const std::vector<float> & input = m_deltaInputs[d];
+        float delta = 0.f;
+        for (int k = 0; k < filterSize; ++k) {
+            int idx = std::min( std::max( frame - m_halfFilterLen + k, 0 ), last );
+            delta += m_deltaFilter[k] * input[idx];
+        }
+        accumulate( Statistics::INPUT_FEATURE_COUNT + d, delta, m_gates[frame] );
+    }
+}
+
+void FeatureIndex::accumulate( int column, float value, bool gated )
+{
+    double d = 0.0;
+    if (gated) {
+        if (!m_hasShift[column]) {
+            m_shift[column] = value;
+            m_hasShift[column] = true;
+        }
+        d = value - m_shift[column];
+    }
+    m_sum[column].push_back( m_sum[column].back() + d );
+    m_sumOfSquares[column].push_back( m_sumOfSquares[column].back() + d * d );
+}
+
+int FeatureIndex::frame( double seconds ) const
+{
+    double frame = std::ceil( seconds * m_frameRate - 1e-9 );
+    return (int) std::min( std::max( frame, 0.0 ), (double) frameCount() );
+}
+
+FeatureIndex::Summary FeatureIndex::summary( int column, int begin, int end ) const
+{
+    Summary result = { 0, 0.0, 0.0, 0.0 };
+    if (column < 0 || column >= COLUMN_COUNT)
+        return result;
+
+    const int available = (int) m_sum[column].size() - 1;
+    begin = std::max( begin, 0 );
+    end = std::min( end, available );
+    if (begin >= end)
+        return result;
+
+    const double n = m_count[end] - m_count[begin];
+    const double s = m_sum[column][end] - m_sum[column][begin];
+    const double q = m_sumOfSquares[column][end] - m_sumOfSquares[column][begin];
+
+    result.count = (int) n;
+    if (n > 0)
+        result.mean = m_shift[column] + s / n;
+    if (n > 1)
+        result.variance = std::max( (q - s * s / n) / (n - 1), 0.0 );
+    result.stdDev = std::sqrt( result.variance );
+    return result;
+}
+
+FeatureIndex::Summary FeatureIndex::summary( int column, double t0, double t1 ) const
+{
+    return summary( column, frame(t0), frame(t1) );
+}
+
+bool FeatureIndex::save( const std::string & filename ) const
+{
+    std::ofstream out( filename.c_str(), std::ios::out | std::ios::binary );
+    if (!out.is_open())
+        return false;
+
+    int32_t columnCount = COLUMN_COUNT;
+    out.write( s_magic, sizeof(s_magic) );
+    out.write( reinterpret_cast<const char*>(&columnCount), sizeof(columnCount) );
+    out.write( reinterpret_cast<const char*>(&m_frameRate), sizeof(m_frameRate) );
+    out.write( reinterpret_cast<const char*>(m_shift), sizeof(m_shift) );
+    write( out, m_count );
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        write( out, m_sum[c] );
+        write( out, m_sumOfSquares[c] );
+    }
+
+    return (bool) out;
+}
+
+bool FeatureIndex::load( const std::string & filename )
+{
+    std::ifstream in( filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate );
+    if (!in.is_open())
+        return false;
+    const std::streamoff end = in.tellg();
+    in.seekg( 0 );
+
+    char magic[sizeof(s_magic)];
+    int32_t columnCount = 0;
+    in.read( magic, sizeof(magic) );
+    in.read( reinterpret_cast<char*>(&columnCount), sizeof(columnCount) );
+    if (!in || std::memcmp( magic, s_magic, sizeof(magic) ) != 0 || columnCount != COLUMN_COUNT)
+        return false;
+
+    FeatureIndex index;
+    in.read( reinterpret_cast<char*>(&index.m_frameRate), sizeof(index.m_frameRate) );
+    in.read( reinterpret_cast<char*>(index.m_shift), sizeof(index.m_shift) );
+    if (!in || !(index.m_frameRate > 0.0) || !std::isfinite( index.m_frameRate ))
+        return false;
+    if (!read( in, index.m_count, end ))
+        return false;
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        if (!read( in, index.m_sum[c], end ) || !read( in, index.m_sumOfSquares[c], end ))
+            return false;
+        if (index.m_sum[c].size() > index.m_count.size()
+                || index.m_sumOfSquares[c].size() != index.m_sum[c].size())
+            return false;
+    }
+
+    index.m_finished = true;
+    *this = index;
+    return true;
+}
+
+} // namespace Segmenter
@@ -0,0 +1,114 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_FEATURE_INDEX_HPP_INCLUDED
+#define SEGMENTER_FEATURE_INDEX_HPP_INCLUDED
+
+#include "statistics.hpp"
+
+#include <vector>
+#include <string>
+
+namespace Segmenter {
+
+/*
+    Gated prefix sums of the features of a whole recording.
+
+    For each input feature and each delta feature used by Statistics,
+    the index holds the sums and sums of squares of the values of frames
+    [0, n) passing the energy gate, and the count of those frames, for all n.
+    The gated mean, variance and standard deviation of any range of frames
+    is then given in constant time, as by Statistics for its windows.
+
+    Sums are in double precision, of differences to the first gated value
+    of each feature, which keeps the variance of long ranges accurate.
+    Deltas are computed with the filter of Statistics; the first and last
+    frames are padded by repeating them, so every frame has a delta
+    after finish().
+*/
+class FeatureIndex
+{
+public:
+    enum Column {
+        // Input features, as Statistics::InputFeature
+        ENTROPY_DELTA = Statistics::INPUT_FEATURE_COUNT,
+        MFCC2_DELTA,
+        MFCC3_DELTA,
+        MFCC4_DELTA,
+
+        COLUMN_COUNT
+    };
+
+    struct Summary {
+        int count;
+        double mean;
+        double variance;
+        double stdDev;
+    };
+
+    FeatureIndex( double frameRate = 1.0, int deltaWindowSize = 5 );
+
+    void append( const Statistics::InputFeatures * frames, int count );
+    // Computes the deltas of the last frames
+    void finish();
+
+    int frameCount() const { return (int) m_count.size() - 1; }
+    // Frames per second
+    double frameRate() const { return m_frameRate; }
+    // First frame starting at or after 'seconds', within [0, frameCount()]
+    int frame( double seconds ) const;
+
+    // Gated statistics of 'column' over frames [begin, end);
+    // delta columns cover the frames whose deltas are computed.
+    Summary summary( int column, int begin, int end ) const;
+    // Gated statistics over the frames starting in [t0, t1) seconds
+    Summary summary( int column, double t0, double t1 ) const;
+
+    // Writes the index in native byte order; returns false on failure
+    bool save( const std::string & filename ) const;
+    // Replaces the index with one written by save(); returns false on failure
+    bool load( const std::string & filename );
+
+private:
+    static const int DELTA_FEATURE_COUNT = COLUMN_COUNT - Statistics::INPUT_FEATURE_COUNT;
+
+    void appendDelta( int frame );
+    void accumulate( int column, float value, bool gated );
+
+    double m_frameRate;
+    std::vector<float> m_deltaFilter;
+    int m_halfFilterLen;
+    bool m_finished;
+
+    // Inputs of the delta features, of all frames
+    std::vector<float> m_deltaInputs[DELTA_FEATURE_COUNT];
+    std::vector<bool> m_gates;
+
+    // Gated frame count, sums and sums of squares of frames [0, n) at n
+    std::vector<double> m_count;
+    std::vector<double> m_sum[COLUMN_COUNT];
+    std::vector<double> m_sumOfSquares[COLUMN_COUNT];
+    double m_shift[COLUMN_COUNT];
+    bool m_hasShift[COLUMN_COUNT];
+};
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_FEATURE_INDEX_HPP_INCLUDED
@@ -0,0 +1,170 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "fft.hpp"
+#include "builtin_fft.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifndef SEGMENTER_NO_FFTW
+#include <fftw3.h>
+#endif
+
+namespace Segmenter {
+
+namespace {
+
+const char * s_backendNames[FftBackendCount] = {
+    "fftw",
+    "builtin"
+};
+
+#ifndef SEGMENTER_NO_FFTW
+class FftwTransform : public RealTransform
+{
+    int m_size;
+    float *m_input;
+    float *m_output;
+    fftwf_plan m_plan;
+
+public:
+    FftwTransform( Kind kind, int size ):
+        m_size(size)
+    {
+        m_input = fftwf_alloc_real(size);
+        m_output = fftwf_alloc_real(size);
+        m_plan = fftwf_plan_r2r_1d( size, m_input, m_output,
+                                    kind == Dct2 ? FFTW_REDFT10 : FFTW_R2HC, FFTW_ESTIMATE );
+        for (int i = 0; i < size; ++i)
+            m_input[i] = m_output[i] = 0.f;
+    }
+
+    ~FftwTransform()
+    {
+        fftwf_destroy_plan(m_plan);
+        fftwf_free(m_input);
+        fftwf_free(m_output);
+    }
+
+    float * input() { return m_input; }
+    const float * output() const { return m_output; }
+    void execute() { fftwf_execute(m_plan); }
+
+    int size() const { return m_size; }
+    FftBackend backend() const { return FftwBackend; }
+};
+#endif
+
+template <typename Transform>
+class BuiltinTransform : public RealTransform
+{
+    Transform m_transform;
+
+public:
+    BuiltinTransform() {}
+    explicit BuiltinTransform( int size ): m_transform(size) {}
+
+    float * input() { return m_transform.input(); }
+    const float * output() const { return m_transform.output(); }
+    void execute() { m_transform.execute(); }
+
+    int size() const { return m_transform.size(); }
+    FftBackend backend() const { return BuiltinBackend; }
+};
+
+RealTransform * createBuiltinTransform( RealTransform::Kind kind, int size )
+{
+    if (kind == RealTransform::RealToHalfComplex)
+    {
+        // 512 at the analysis rate, and the larger ones for the native rate front end
+        switch (size) {
+        case 512: return new BuiltinTransform< BuiltinRealFft<512> >();
+        case 1024: return new BuiltinTransform< BuiltinRealFft<1024> >();
+        case 2048: return new BuiltinTransform< BuiltinRealFft<2048> >();
+        case 4096: return new BuiltinTransform< BuiltinRealFft<4096> >();
+        }
+        return new BuiltinTransform<BuiltinRealDft>( size );
+    }
+    else
+    {
+        return new BuiltinTransform<BuiltinDct2>( size );
+    }
+}
+
+bool hasBackend( FftBackend backend )
+{
+#ifdef SEGMENTER_NO_FFTW
+    return backend == BuiltinBackend;
+#else
+    return backend >= 0 && backend < FftBackendCount;
+#endif
+}
+
+FftBackend defaultFftBackend()
+{
+    const char *requested = std::getenv("SEGMENTER_FFT");
+    if (requested && *requested) {
+        for (int i = 0; i < FftBackendCount; ++i) {
+            if (std::strcmp(requested, s_backendNames[i]) == 0 && hasBackend( (FftBackend) i ))
+                return (FftBackend) i;
+        }
+        std::cerr << "*** WARNING: Unknown or unavailable SEGMENTER_FFT: " << requested << std::endl;
+    }
+
+#if defined(SEGMENTER_DEFAULT_FFT_BUILTIN) || defined(SEGMENTER_NO_FFTW)
+    return BuiltinBackend;
+#else
+    return FftwBackend;
+#endif
+}
+
+} // namespace
+
+FftBackend fftBackend()
+{
+    static FftBackend backend = defaultFftBackend();
+    return backend;
+}
+
+const char * fftBackendName( FftBackend backend )
+{
+    return backend >= 0 && backend < FftBackendCount ? s_backendNames[backend] : "unknown";
+}
+
+bool hasTransform( FftBackend backend, RealTransform::Kind, int size )
+{
+    return hasBackend( backend ) && size > 0;
+}
+
+RealTransform * createTransform( RealTransform::Kind kind, int size, FftBackend backend )
+{
+#ifdef SEGMENTER_NO_FFTW
+    (void) backend;
+#else
+    if (backend == FftwBackend)
+        return new FftwTransform( kind, size );
+#endif
+    return createBuiltinTransform( kind, size );
+}
+
+} // namespace Segmenter
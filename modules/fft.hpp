@@ -0,0 +1,76 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_FFT_BACKEND_HPP_INCLUDED
+#define SEGMENTER_FFT_BACKEND_HPP_INCLUDED
+
+namespace Segmenter {
+
+enum FftBackend {
+    // Unavailable when built with SEGMENTER_NO_FFTW
+    FftwBackend = 0,
+    // Header-only transforms of builtin_fft.hpp, of any size
+    BuiltinBackend,
+
+    FftBackendCount
+};
+
+/*
+    Real transform of a fixed kind and size, with its own input and output
+    buffers of size() elements, in the conventions of FFTW:
+
+    RealToHalfComplex (FFTW_R2HC):
+        out[k] = Re X[k] for k in [0, N/2], out[N - k] = Im X[k] for k in (0, N/2)
+    Dct2 (FFTW_REDFT10):
+        out[k] = 2 sum x[n] cos(pi k (n + 1/2) / N)
+*/
+class RealTransform
+{
+public:
+    enum Kind { RealToHalfComplex, Dct2 };
+
+    virtual ~RealTransform() {}
+
+    virtual float * input() = 0;
+    virtual const float * output() const = 0;
+    virtual void execute() = 0;
+
+    virtual int size() const = 0;
+    virtual FftBackend backend() const = 0;
+};
+
+// Backend used by default: SEGMENTER_FFT in the environment ("fftw" or "builtin"),
+// otherwise the one chosen at build time by SEGMENTER_DEFAULT_FFT_BUILTIN.
+// Always the builtin backend when built without FFTW.
+FftBackend fftBackend();
+
+const char * fftBackendName( FftBackend backend );
+
+// Whether 'backend' has a transform of this kind and size
+bool hasTransform( FftBackend backend, RealTransform::Kind kind, int size );
+
+// Transform of the given kind and size from 'backend',
+// or from the builtin backend if 'backend' is unavailable
+RealTransform * createTransform( RealTransform::Kind kind, int size,
+                                 FftBackend backend = fftBackend() );
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_FFT_BACKEND_HPP_INCLUDED
@@ -0,0 +1,254 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_FILTER_BANK_HPP_INCLUDED
+#define SEGMENTER_FILTER_BANK_HPP_INCLUDED
+
+#include "module.hpp"
+#include "kernels.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace Segmenter {
+
+/*
+    A bank of filters, each spanning a contiguous range of input bins,
+    stored in compressed sparse row form: the coefficients of all filters
+    are kept in one array, and row pointers mark where each filter starts.
+
+    Each row is zero-padded to a multiple of s_padding coefficients, so the
+    kernels run without scalar tails. Padding is placed before the filter
+    where it would otherwise reach past the end of the input.
+
+    Banks over different inputs can be stacked with append(), to apply
+    them all with a single product over concatenated inputs.
+*/
+class SparseFilterBank
+{
+    int m_inputSize;
+    std::vector<int> m_rowPointers;
+    std::vector<int> m_columnOffsets;
+    std::vector<float> m_coefficients;
+
+public:
+    static const int s_padding = 8;
+
+    SparseFilterBank( int inputSize = 0 ):
+        m_inputSize(inputSize),
+        m_rowPointers(1, 0)
+    {}
+
+    // Filters already in padded form, as given by filterOffset(),
+    // filterSize() and filterCoefficients(); 'rowPointers' has filterCount + 1 elements.
+    SparseFilterBank( int inputSize, int filterCount, const int *rowPointers,
+                      const int *columnOffsets, const float *coefficients ):
+        m_inputSize(inputSize),
+        m_rowPointers(rowPointers, rowPointers + filterCount + 1),
+        m_columnOffsets(columnOffsets, columnOffsets + filterCount),
+        m_coefficients(coefficients, coefficients + rowPointers[filterCount])
+    {}
+
+    int inputSize() const { return m_inputSize; }
+    int filterCount() const { return m_columnOffsets.size(); }
+
+    // Padded extent of a filter
+    int filterOffset( int row ) const { return m_columnOffsets[row]; }
+    int filterSize( int row ) const { return m_rowPointers[row + 1] - m_rowPointers[row]; }
+    const float * filterCoefficients( int row ) const { return m_coefficients.data() + m_rowPointers[row]; }
+
+    // Range of input bins read by all filters, including padding
+    BinRange inputRange() const
+    {
+        BinRange range;
+        for (int row = 0; row < filterCount(); ++row) {
+            if (filterSize(row))
+                range |= BinRange( filterOffset(row), filterOffset(row) + filterSize(row) );
+        }
+        return range;
+    }
+
+    void addFilter( int offset, const float *coefficients, int count )
+    {
+        int paddedCount = (count + s_padding - 1) / s_padding * s_padding;
+        if (paddedCount > m_inputSize)
+            paddedCount = count;
+
+        int paddedOffset = offset;
+        if (paddedOffset + paddedCount > m_inputSize)
+            paddedOffset = m_inputSize - paddedCount;
+        if (count == 0)
+            paddedOffset = 0;
+
+        assert(offset >= 0 || count == 0);
+        assert(offset + count <= m_inputSize);
+
+        int begin = m_coefficients.size();
+        m_coefficients.resize( begin + paddedCount, 0.f );
+        for (int i = 0; i < count; ++i)
+            m_coefficients[begin + offset - paddedOffset + i] = coefficients[i];
+
+        m_columnOffsets.push_back( paddedOffset );
+        m_rowPointers.push_back( m_coefficients.size() );
+    }
+
+    // Appends the filters of 'other', reading input starting at 'inputOffset'.
+    void append( const SparseFilterBank & other, int inputOffset )
+    {
+        int coeffOffset = m_coefficients.size();
+        m_coefficients.insert( m_coefficients.end(),
+                               other.m_coefficients.begin(), other.m_coefficients.end() );
+        for (int row = 0; row < other.filterCount(); ++row) {
+            int columnOffset = other.filterSize(row) ? other.m_columnOffsets[row] + inputOffset : 0;
+            m_columnOffsets.push_back( columnOffset );
+            m_rowPointers.push_back( other.m_rowPointers[row + 1] + coeffOffset );
+        }
+        if (inputOffset + other.m_inputSize > m_inputSize)
+            m_inputSize = inputOffset + other.m_inputSize;
+    }
+
+    void process( const float *input, float *output ) const
+    {
+        const Kernels & k = kernels();
+        const float *coefficients = m_coefficients.data();
+        const int rowCount = m_columnOffsets.size();
+        for (int row = 0; row < rowCount; ++row) {
+            int begin = m_rowPointers[row];
+            int end = m_rowPointers[row + 1];
+            output[row] = k.dot( coefficients + begin, input + m_columnOffsets[row], end - begin );
+        }
+    }
+};
+
+/*
+    Filter bank applied to a batch of frames at once, as a matrix product
+    of [frames x input] by [input x filters].
+
+    Filters are grouped into panels of s_panelWidth adjacent filters.
+    Each panel stores dense weights only over the input range its filters
+    span, so the band structure of the filters still saves most of the work,
+    while the kernel keeps a block of frames by a panel of filters
+    in registers. Frames are processed in blocks of s_frameBlock, so that
+    each block of input stays in cache while all panels are applied to it.
+*/
+class FilterMatrix
+{
+    struct Panel {
+        int inputOffset;
+        int span;
+        int weightOffset;
+        int outputOffset;
+    };
+
+    std::vector<Panel> m_panels;
+    std::vector<float> m_weights;
+    int m_inputSize;
+    int m_outputSize;
+
+public:
+    static const int s_panelWidth = 8;
+    static const int s_frameBlock = 32;
+
+    FilterMatrix(): m_inputSize(0), m_outputSize(0) {}
+
+    // Input row size read by the panels
+    int inputSize() const { return m_inputSize; }
+
+    // Output row size, including padding of each appended bank
+    // to a multiple of s_panelWidth.
+    int outputSize() const { return m_outputSize; }
+
+    // Appends the filters of 'bank', reading input starting at 'inputOffset'.
+    // The offset may be negative, if the input rows only hold the bins
+    // from bank.inputRange() on.
+    // Returns the position of the first filter in the output rows.
+    int append( const SparseFilterBank & bank, int inputOffset )
+    {
+        const int outputOffset = m_outputSize;
+        const int filterCount = bank.filterCount();
+
+        for (int first = 0; first < filterCount; first += s_panelWidth)
+        {
+            int last = std::min( first + s_panelWidth, filterCount );
+
+            int begin = bank.inputSize();
+            int end = 0;
+            for (int row = first; row < last; ++row) {
+                if (!bank.filterSize(row))
+                    continue;
+                begin = std::min( begin, bank.filterOffset(row) );
+                end = std::max( end, bank.filterOffset(row) + bank.filterSize(row) );
+            }
+            if (end < begin)
+                begin = end = 0;
+
+            Panel panel;
+            panel.inputOffset = inputOffset + begin;
+            panel.span = end - begin;
+            panel.weightOffset = m_weights.size();
+            panel.outputOffset = outputOffset + first;
+
+            m_weights.resize( m_weights.size() + panel.span * s_panelWidth, 0.f );
+            float *weights = m_weights.data() + panel.weightOffset;
+            for (int row = first; row < last; ++row) {
+                const float *coefficients = bank.filterCoefficients(row);
+                const int offset = bank.filterOffset(row) - begin;
+                for (int i = 0; i < bank.filterSize(row); ++i)
+                    weights[(offset + i) * s_panelWidth + (row - first)] = coefficients[i];
+            }
+
+            m_panels.push_back( panel );
+        }
+
+        m_outputSize += (filterCount + s_panelWidth - 1) / s_panelWidth * s_panelWidth;
+        if (!bank.inputRange().empty())
+            m_inputSize = std::max( m_inputSize, inputOffset + bank.inputRange().end );
+
+        return outputOffset;
+    }
+
+    void process( const float *input, int inputStride, int frames,
+                  float *output, int outputStride ) const
+    {
+        const Kernels & k = kernels();
+        const int panelCount = m_panels.size();
+
+        for (int blockStart = 0; blockStart < frames; blockStart += s_frameBlock)
+        {
+            const int blockEnd = std::min( blockStart + s_frameBlock, frames );
+
+            for (int p = 0; p < panelCount; ++p)
+            {
+                const Panel & panel = m_panels[p];
+                const float *weights = m_weights.data() + panel.weightOffset;
+
+                k.filterPanel( input + blockStart * inputStride + panel.inputOffset, inputStride,
+                               blockEnd - blockStart,
+                               weights, panel.span,
+                               output + blockStart * outputStride + panel.outputOffset, outputStride );
+            }
+        }
+    }
+};
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_FILTER_BANK_HPP_INCLUDED
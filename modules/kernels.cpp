@@ -0,0 +1,353 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "kernels.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <atomic>
+
+namespace Segmenter {
+
+namespace {
+
+float sumOfSquares( const float *x, int n )
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i] * x[i];
+        s1 += x[i+1] * x[i+1];
+        s2 += x[i+2] * x[i+2];
+        s3 += x[i+3] * x[i+3];
+    }
+    for (; i < n; ++i)
+        s0 += x[i] * x[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+void multiply( const float *a, const float *b, float *out, int n )
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = a[i] * b[i];
+}
+
+float dot( const float *a, const float *b, int n )
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i+1] * b[i+1];
+        s2 += a[i+2] * b[i+2];
+        s3 += a[i+3] * b[i+3];
+    }
+    for (; i < n; ++i)
+        s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+void axpy( float a, const float *x, float *y, int n )
+{
+    for (int i = 0; i < n; ++i)
+        y[i] += a * x[i];
+}
+
+void maskedMoments( const float * const *x, const float *shift, int columns,
+                    const float *mask, int n, float *moments )
+{
+    float count = 0.f;
+    float sums[2 * Kernels::maxMomentColumns];
+    for (int c = 0; c < 2 * columns; ++c)
+        sums[c] = 0.f;
+    for (int i = 0; i < n; ++i) {
+        const bool gated = mask[i] != 0.f;
+        count += gated ? 1.f : 0.f;
+        for (int c = 0; c < columns; ++c) {
+            float d = gated ? x[c][i] - shift[c] : 0.f;
+            sums[2 * c] += d;
+            sums[2 * c + 1] += d * d;
+        }
+    }
+    moments[0] = count;
+    for (int c = 0; c < 2 * columns; ++c)
+        moments[1 + c] = sums[c];
+}
+
+void scale( float a, const float *x, float *out, int n )
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = a * x[i];
+}
+
+void clampedSqrt( const float *x, float floor, float *out, int n )
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = std::sqrt( x[i] > floor ? x[i] : floor );
+}
+
+void clampedLog( const float *x, float floor, float *out, int n )
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = std::log( x[i] > floor ? x[i] : floor );
+}
+
+// Fast approximations:
+// log(m * 2^e) = e log(2) + 2 atanh(s), with s = (m - 1) / (m + 1), m in [sqrt(1/2), sqrt(2)],
+// and atanh(s) ~ s + s^3 / 3; the vector versions use an approximate reciprocal.
+// exp(x) = 2^n * 2^f, with f in [-1/2, 1/2], and a 4th order polynomial for 2^f.
+
+inline float fastLog( float x )
+{
+    int bits;
+    std::memcpy( &bits, &x, sizeof(float) );
+    int e = ((bits >> 23) & 0xff) - 127;
+    bits = (bits & 0x007fffff) | 0x3f800000;
+    float m;
+    std::memcpy( &m, &bits, sizeof(float) );
+    if (m > 1.41421356f) {
+        m *= 0.5f;
+        e += 1;
+    }
+    float s = (m - 1.f) / (m + 1.f);
+    float s2 = s * s;
+    return e * 0.693147181f + s * (2.f + s2 * 0.666666667f);
+}
+
+inline float fastExp( float x )
+{
+    x = std::min( std::max( x, -87.f ), 88.f );
+    float t = x * 1.44269504f;
+    float n = std::floor( t + 0.5f );
+    float f = t - n;
+    float p = 1.f + f * (0.693147181f + f * (0.240226507f + f * (0.0555041087f + f * 0.00961812911f)));
+    int bits = ((int) n + 127) << 23;
+    float scale;
+    std::memcpy( &scale, &bits, sizeof(float) );
+    return p * scale;
+}
+
+void fastLog( const float *x, float floor, float *out, int n )
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = fastLog( x[i] > floor ? x[i] : floor );
+}
+
+void fastSqrt( const float *x, float floor, float *out, int n )
+{
+    clampedSqrt( x, floor, out, n );
+}
+
+void fastExp( const float *x, float *out, int n )
+{
+    for (int i = 0; i < n; ++i)
+        out[i] = fastExp( x[i] );
+}
+
+void largestFive( const float *x, int n, float *largest )
+{
+    // kept in locals, so that they stay in registers
+    float t0, t1, t2, t3, t4;
+    t0 = t1 = t2 = t3 = t4 = -std::numeric_limits<float>::infinity();
+
+    for (int i = 0; i < n; ++i) {
+        float v = x[i];
+        float higher;
+        higher = std::max( t0, v ); v = std::min( t0, v ); t0 = higher;
+        higher = std::max( t1, v ); v = std::min( t1, v ); t1 = higher;
+        higher = std::max( t2, v ); v = std::min( t2, v ); t2 = higher;
+        higher = std::max( t3, v ); v = std::min( t3, v ); t3 = higher;
+        t4 = std::max( t4, v );
+    }
+
+    largest[0] = t0;
+    largest[1] = t1;
+    largest[2] = t2;
+    largest[3] = t3;
+    largest[4] = t4;
+}
+
+void halfComplexPower( const float *fft, int size, float scale, float *out )
+{
+    out[0] = fft[0] * fft[0] * scale;
+
+    const int pairCount = (size + 1) / 2;
+    for (int idx = 1; idx < pairCount; ++idx) {
+        float r = fft[idx];
+        float i = fft[size - idx];
+        out[idx] = (r * r + i * i) * scale;
+    }
+
+    if (size % 2 == 0)
+        out[size / 2] = fft[size / 2] * fft[size / 2] * scale;
+}
+
+void filterPanel( const float *input, int inputStride, int frames,
+                  const float *weights, int span,
+                  float *output, int outputStride )
+{
+    for (int f = 0; f < frames; ++f) {
+        const float *in = input + f * inputStride;
+        float acc[8] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+        for (int k = 0; k < span; ++k) {
+            const float x = in[k];
+            const float *w = weights + k * 8;
+            for (int j = 0; j < 8; ++j)
+                acc[j] += x * w[j];
+        }
+        float *out = output + f * outputStride;
+        for (int j = 0; j < 8; ++j)
+            out[j] = acc[j];
+    }
+}
+
+void fir( const float *x, const float *taps, int tapCount, float *out, int n )
+{
+    for (int i = 0; i < n; ++i) {
+        float s = 0.f;
+        for (int k = 0; k < tapCount; ++k)
+            s += taps[k] * x[i + k];
+        out[i] = s;
+    }
+}
+
+const Kernels s_scalarKernels = {
+    ScalarInstructions,
+    "scalar",
+    sumOfSquares,
+    multiply,
+    dot,
+    axpy,
+    maskedMoments,
+    scale,
+    clampedSqrt,
+    clampedLog,
+    fastLog,
+    fastSqrt,
+    fastExp,
+    largestFive,
+    halfComplexPower,
+    filterPanel,
+    fir
+};
+
+const char * s_instructionSetNames[InstructionSetCount] = {
+    "scalar", "sse", "avx2", "avx512"
+};
+
+bool isAvailable( InstructionSet instructionSet )
+{
+    return kernelsFor( instructionSet ) && cpuSupports( instructionSet );
+}
+
+const Kernels * defaultKernels()
+{
+    const char *requested = std::getenv("SEGMENTER_ISA");
+    if (requested && *requested) {
+        int i;
+        for (i = 0; i < InstructionSetCount; ++i) {
+            if (std::strcmp(requested, s_instructionSetNames[i]) == 0)
+                break;
+        }
+        if (i == InstructionSetCount)
+            std::cerr << "*** WARNING: Unknown SEGMENTER_ISA: " << requested << std::endl;
+        else if (!isAvailable( (InstructionSet) i ))
+            std::cerr << "*** WARNING: SEGMENTER_ISA=" << requested
+                      << " is not available on this machine." << std::endl;
+        else
+            return kernelsFor( (InstructionSet) i );
+    }
+
+    for (int i = InstructionSetCount - 1; i > ScalarInstructions; --i) {
+        if (isAvailable( (InstructionSet) i ))
+            return kernelsFor( (InstructionSet) i );
+    }
+
+    return &s_scalarKernels;
+}
+
+// Selected from any thread while the modules read it
+std::atomic<const Kernels*> & currentKernels()
+{
+    static std::atomic<const Kernels*> k( defaultKernels() );
+    return k;
+}
+
+} // namespace
+
+const Kernels * Detail::scalarKernels()
+{
+    return &s_scalarKernels;
+}
+
+const Kernels * kernelsFor( InstructionSet instructionSet )
+{
+    switch (instructionSet) {
+    case ScalarInstructions:
+        return Detail::scalarKernels();
+    case SseInstructions:
+        return Detail::sseKernels();
+    case Avx2Instructions:
+        return Detail::avx2Kernels();
+    case Avx512Instructions:
+        return Detail::avx512Kernels();
+    default:
+        return 0;
+    }
+}
+
+const Kernels & kernels()
+{
+    return *currentKernels().load( std::memory_order_acquire );
+}
+
+bool cpuSupports( InstructionSet instructionSet )
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    switch (instructionSet) {
+    case ScalarInstructions:
+        return true;
+    case SseInstructions:
+        return __builtin_cpu_supports("sse2");
+    case Avx2Instructions:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Avx512Instructions:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        return false;
+    }
+#else
+    return instructionSet == ScalarInstructions;
+#endif
+}
+
+bool selectKernels( InstructionSet instructionSet )
+{
+    if (!isAvailable( instructionSet ))
+        return false;
+    currentKernels().store( kernelsFor( instructionSet ), std::memory_order_release );
+    return true;
+}
+
+} // namespace Segmenter
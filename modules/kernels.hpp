@@ -0,0 +1,141 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_KERNELS_HPP_INCLUDED
+#define SEGMENTER_KERNELS_HPP_INCLUDED
+
+namespace Segmenter {
+
+enum InstructionSet {
+    ScalarInstructions = 0,
+    SseInstructions,
+    Avx2Instructions,
+    Avx512Instructions,
+
+    InstructionSetCount
+};
+
+/*
+    Table of numeric kernels used in the inner loops of the modules.
+    There is one table per instruction set; all implementations compute
+    the same results up to floating point rounding.
+    Pointers need not be aligned.
+*/
+struct Kernels
+{
+    enum { maxMomentColumns = 16 };
+
+    InstructionSet instructionSet;
+    const char *name;
+
+    // sum of x[i] * x[i]
+    float (*sumOfSquares)( const float *x, int n );
+
+    // out[i] = a[i] * b[i]
+    void (*multiply)( const float *a, const float *b, float *out, int n );
+
+    // sum of a[i] * b[i]
+    float (*dot)( const float *a, const float *b, int n );
+
+    // y[i] += a * x[i]
+    void (*axpy)( float a, const float *x, float *y, int n );
+
+    // Over i for which mask[i] != 0, for each column c of up to
+    // maxMomentColumns, in one pass over the mask and without branches:
+    // moments[0] = count, moments[1 + 2c] = sum of x[c][i] - shift[c],
+    // moments[2 + 2c] = sum of (x[c][i] - shift[c])^2.
+    // x[c][i] of other i need not be finite.
+    void (*maskedMoments)( const float * const *x, const float *shift, int columns,
+                           const float *mask, int n, float *moments );
+
+    // out[i] = a * x[i]
+    void (*scale)( float a, const float *x, float *out, int n );
+
+    // out[i] = sqrt( max(x[i], floor) )
+    void (*clampedSqrt)( const float *x, float floor, float *out, int n );
+
+    // out[i] = log( max(x[i], floor) ), for a positive normal 'floor'.
+    // Vector versions are within 1 ulp of std::log.
+    void (*clampedLog)( const float *x, float floor, float *out, int n );
+
+    // Fast approximations, with the maximum relative error measured
+    // over the whole range (scalar / SSE and AVX2 / AVX-512):
+
+    // out[i] ~ log( max(x[i], floor) ), for a positive normal 'floor'
+    // 2e-4 / 4e-4 / 2e-4
+    void (*fastLog)( const float *x, float floor, float *out, int n );
+
+    // out[i] ~ sqrt( max(x[i], floor) ), for finite x
+    // exact / 3.3e-4 / 6e-5, results below 1.1e-19 may be raised to it
+    void (*fastSqrt)( const float *x, float floor, float *out, int n );
+
+    // out[i] ~ exp(x[i]), for x clamped to [-87, 88]
+    // 6e-5 on all
+    void (*fastExp)( const float *x, float *out, int n );
+
+    // The 5 largest of x[0] ... x[n - 1], in descending order,
+    // padded with -infinity if n < 5.
+    void (*largestFive)( const float *x, int n, float *largest );
+
+    // out[k] = scale * |X[k]|^2, for k in [0, size/2],
+    // where X is given in FFTW's halfcomplex format of length 'size'.
+    void (*halfComplexPower)( const float *halfComplex, int size, float scale, float *out );
+
+    // Multiplies 'frames' rows of 'input' by a panel of 8 filters,
+    // given as 'span' rows of 8 weights, and writes 8 outputs per frame:
+    // output[f * outputStride + j] = sum over k of input[f * inputStride + k] * weights[k * 8 + j]
+    void (*filterPanel)( const float *input, int inputStride, int frames,
+                         const float *weights, int span,
+                         float *output, int outputStride );
+
+    // out[i] = sum over k of taps[k] * x[i + k], for i in [0, n);
+    // x holds n + tapCount - 1 values
+    void (*fir)( const float *x, const float *taps, int tapCount, float *out, int n );
+};
+
+// Returns the kernels for the given instruction set,
+// or 0 if they were not compiled into this build.
+const Kernels * kernelsFor( InstructionSet instructionSet );
+
+// Kernels used by the modules.
+// On first use, the best instruction set supported by both this build and
+// the CPU is selected, unless the SEGMENTER_ISA environment variable
+// requests one of: scalar, sse, avx2, avx512.
+const Kernels & kernels();
+
+// Whether the CPU we are running on supports the given instruction set.
+bool cpuSupports( InstructionSet instructionSet );
+
+// Makes the modules use the given instruction set.
+// Returns false and keeps the current kernels if not available
+// in this build or not supported by the CPU.
+// Safe to call while other threads run the modules.
+bool selectKernels( InstructionSet instructionSet );
+
+namespace Detail {
+const Kernels * scalarKernels();
+const Kernels * sseKernels();
+const Kernels * avx2Kernels();
+const Kernels * avx512Kernels();
+}
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_KERNELS_HPP_INCLUDED
@@ -0,0 +1,548 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "kernels.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace Segmenter {
+
+namespace {
+
+inline float horizontalSum( __m128 v )
+{
+    __m128 shuf = _mm_movehdup_ps(v);
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+inline float horizontalSum( __m256 v )
+{
+    return horizontalSum( _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)) );
+}
+
+// Mask of the first 'remaining' lanes, for maskload and maskstore
+inline __m256i tailMask( int remaining )
+{
+    return _mm256_cmpgt_epi32( _mm256_set1_epi32(remaining), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) );
+}
+
+float sumOfSquares( const float *x, int n )
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256 a = _mm256_loadu_ps(x + i);
+        __m256 b = _mm256_loadu_ps(x + i + 8);
+        __m256 c = _mm256_loadu_ps(x + i + 16);
+        __m256 d = _mm256_loadu_ps(x + i + 24);
+        s0 = _mm256_fmadd_ps(a, a, s0);
+        s1 = _mm256_fmadd_ps(b, b, s1);
+        s2 = _mm256_fmadd_ps(c, c, s2);
+        s3 = _mm256_fmadd_ps(d, d, s3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(x + i);
+        s0 = _mm256_fmadd_ps(a, a, s0);
+    }
+    float s = horizontalSum( _mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)) );
+    for (; i < n; ++i)
+        s += x[i] * x[i];
+    return s;
+}
+
+void multiply( const float *a, const float *b, float *out, int n )
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    for (; i < n; ++i)
+        out[i] = a[i] * b[i];
+}
+
+float dot( const float *a, const float *b, int n )
+{
+    // Shorter than one vector: 4 lanes, as in the SSE kernels
+    if (n < 8) {
+        __m128 s = _mm_setzero_ps();
+        int i = 0;
+        if (n >= 4) {
+            s = _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+            i = 4;
+        }
+        float sum = horizontalSum(s);
+        for (; i < n; ++i)
+            sum += a[i] * b[i];
+        return sum;
+    }
+
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+        s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), s2);
+        s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), s3);
+    }
+    for (; i + 8 <= n; i += 8)
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+    float s = horizontalSum( _mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)) );
+    for (; i < n; ++i)
+        s += a[i] * b[i];
+    return s;
+}
+
+void axpy( float a, const float *x, float *y, int n )
+{
+    if (n < 8) {
+        int i = 0;
+        if (n >= 4) {
+            _mm_storeu_ps(y, _mm_fmadd_ps(_mm_set1_ps(a), _mm_loadu_ps(x), _mm_loadu_ps(y)));
+            i = 4;
+        }
+        for (; i < n; ++i)
+            y[i] += a * x[i];
+        return;
+    }
+
+    __m256 va = _mm256_set1_ps(a);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    for (; i < n; ++i)
+        y[i] += a * x[i];
+}
+
+void maskedMoments( const float * const *x, const float *shift, int columns,
+                    const float *mask, int n, float *moments )
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+    __m256 vs[Kernels::maxMomentColumns], s[Kernels::maxMomentColumns], q[Kernels::maxMomentColumns];
+    for (int c = 0; c < columns; ++c) {
+        vs[c] = _mm256_set1_ps(shift[c]);
+        s[c] = q[c] = zero;
+    }
+    __m256 count = zero;
+    for (int i = 0; i < n; i += 8) {
+        const bool full = i + 8 <= n;
+        // lanes past the end load a mask of 0
+        const __m256i tail = tailMask(n - i);
+        __m256 m = full ? _mm256_loadu_ps(mask + i) : _mm256_maskload_ps(mask + i, tail);
+        m = _mm256_cmp_ps(m, zero, _CMP_NEQ_OQ);
+        count = _mm256_add_ps(count, _mm256_and_ps(m, one));
+        for (int c = 0; c < columns; ++c) {
+            __m256 v = full ? _mm256_loadu_ps(x[c] + i) : _mm256_maskload_ps(x[c] + i, tail);
+            __m256 d = _mm256_and_ps(m, _mm256_sub_ps(v, vs[c]));
+            s[c] = _mm256_add_ps(s[c], d);
+            q[c] = _mm256_fmadd_ps(d, d, q[c]);
+        }
+    }
+    moments[0] = horizontalSum(count);
+    for (int c = 0; c < columns; ++c) {
+        moments[1 + 2 * c] = horizontalSum(s[c]);
+        moments[2 + 2 * c] = horizontalSum(q[c]);
+    }
+}
+
+void scale( float a, const float *x, float *out, int n )
+{
+    __m256 va = _mm256_set1_ps(a);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(va, _mm256_loadu_ps(x + i)));
+    for (; i < n; ++i)
+        out[i] = a * x[i];
+}
+
+void clampedSqrt( const float *x, float floor, float *out, int n )
+{
+    __m256 f = _mm256_set1_ps(floor);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_sqrt_ps(_mm256_max_ps(_mm256_loadu_ps(x + i), f)));
+    for (; i < n; ++i)
+        out[i] = std::sqrt( x[i] > floor ? x[i] : floor );
+}
+
+// Natural logarithm of positive normal numbers, after Cephes logf:
+// log(m * 2^e) with m in [sqrt(1/2), sqrt(2)), and a polynomial in m - 1.
+inline __m256 log( __m256 x )
+{
+    const __m256 one = _mm256_set1_ps(1.f);
+    __m256i bits = _mm256_castps_si256(x);
+    __m256 e = _mm256_cvtepi32_ps( _mm256_sub_epi32( _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126) ) );
+    __m256 m = _mm256_castsi256_ps( _mm256_or_si256( _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                                     _mm256_set1_epi32(0x3f000000) ) );
+
+    __m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+    e = _mm256_sub_ps(e, _mm256_and_ps(one, small));
+    m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(m, small));
+
+    __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(7.0376836292E-2f);
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.1514610310E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(1.1676998740E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.2420140846E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(1.4249322787E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.6668057665E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(2.0000714765E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-2.4999993993E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(3.3333331174E-1f));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+
+    y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440E-4f), y);
+    y = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), y);
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, y));
+}
+
+void clampedLog( const float *x, float floor, float *out, int n )
+{
+    __m256 f = _mm256_set1_ps(floor);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, log(_mm256_max_ps(_mm256_loadu_ps(x + i), f)));
+    if (i < n) {
+        // same approximation for the tail
+        float tail[8];
+        for (int j = 0; j < 8; ++j)
+            tail[j] = i + j < n ? x[i + j] : floor;
+        _mm256_storeu_ps(tail, log(_mm256_max_ps(_mm256_loadu_ps(tail), f)));
+        for (int j = i; j < n; ++j)
+            out[j] = tail[j - i];
+    }
+}
+
+// Vector versions of the fast approximations in kernels.cpp
+
+inline __m256 fastLog( __m256 x )
+{
+    const __m256 one = _mm256_set1_ps(1.f);
+    __m256i bits = _mm256_castps_si256(x);
+    __m256 e = _mm256_cvtepi32_ps( _mm256_sub_epi32( _mm256_srli_epi32( _mm256_and_si256(bits, _mm256_set1_epi32(0x7f800000)), 23 ), _mm256_set1_epi32(127) ) );
+    __m256 m = _mm256_castsi256_ps( _mm256_or_si256( _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000) ) );
+    __m256 large = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+    m = _mm256_sub_ps( m, _mm256_and_ps( large, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)) ) );
+    e = _mm256_add_ps( e, _mm256_and_ps( large, one ) );
+    __m256 s = _mm256_mul_ps( _mm256_sub_ps(m, one), _mm256_rcp_ps( _mm256_add_ps(m, one) ) );
+    __m256 s2 = _mm256_mul_ps(s, s);
+    __m256 p = _mm256_mul_ps( s, _mm256_fmadd_ps(s2, _mm256_set1_ps(0.666666667f), _mm256_set1_ps(2.f)) );
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(0.693147181f), p);
+}
+
+inline __m256 fastExp( __m256 x )
+{
+    x = _mm256_min_ps( _mm256_max_ps( x, _mm256_set1_ps(-87.f) ), _mm256_set1_ps(88.f) );
+    __m256 t = _mm256_mul_ps( x, _mm256_set1_ps(1.44269504f) );
+    __m256i n = _mm256_cvtps_epi32( t );
+    __m256 f = _mm256_sub_ps( t, _mm256_cvtepi32_ps(n) );
+    __m256 p = _mm256_set1_ps(0.00961812911f);
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(0.0555041087f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(0.240226507f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(0.693147181f));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.f));
+    __m256 scale = _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_add_epi32(n, _mm256_set1_epi32(127)), 23 ) );
+    return _mm256_mul_ps( p, scale );
+}
+
+inline __m128 fastExp( __m128 x )
+{
+    x = _mm_min_ps( _mm_max_ps( x, _mm_set1_ps(-87.f) ), _mm_set1_ps(88.f) );
+    __m128 t = _mm_mul_ps( x, _mm_set1_ps(1.44269504f) );
+    __m128i n = _mm_cvtps_epi32( t );
+    __m128 f = _mm_sub_ps( t, _mm_cvtepi32_ps(n) );
+    __m128 p = _mm_set1_ps(0.00961812911f);
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(0.0555041087f));
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(0.240226507f));
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(0.693147181f));
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(1.f));
+    __m128 scale = _mm_castsi128_ps( _mm_slli_epi32( _mm_add_epi32(n, _mm_set1_epi32(127)), 23 ) );
+    return _mm_mul_ps( p, scale );
+}
+
+inline __m256 fastSqrt( __m256 x )
+{
+    x = _mm256_max_ps( x, _mm256_set1_ps(1.17549435e-38f) );
+    return _mm256_mul_ps( x, _mm256_rsqrt_ps(x) );
+}
+
+
+void fastLog( const float *x, float floor, float *out, int n )
+{
+    __m256 f = _mm256_set1_ps(floor);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, fastLog(_mm256_max_ps(_mm256_loadu_ps(x + i), f)));
+    if (i < n) {
+        __m256i m = tailMask(n - i);
+        __m256 v = _mm256_maskload_ps(x + i, m);
+        _mm256_maskstore_ps(out + i, m, fastLog(_mm256_max_ps(v, f)));
+    }
+}
+
+void fastSqrt( const float *x, float floor, float *out, int n )
+{
+    __m256 f = _mm256_set1_ps(floor);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, fastSqrt(_mm256_max_ps(_mm256_loadu_ps(x + i), f)));
+    if (i < n) {
+        __m256i m = tailMask(n - i);
+        __m256 v = _mm256_maskload_ps(x + i, m);
+        _mm256_maskstore_ps(out + i, m, fastSqrt(_mm256_max_ps(v, f)));
+    }
+}
+
+void fastExp( const float *x, float *out, int n )
+{
+    // Shorter than one vector: 4 lanes and a copied tail, as in the SSE kernels
+    if (n < 8) {
+        int i = 0;
+        if (n >= 4) {
+            _mm_storeu_ps(out, fastExp(_mm_loadu_ps(x)));
+            i = 4;
+        }
+        if (i < n) {
+            float tail[4];
+            for (int j = 0; j < 4; ++j)
+                tail[j] = i + j < n ? x[i + j] : 0.f;
+            _mm_storeu_ps(tail, fastExp(_mm_loadu_ps(tail)));
+            for (int j = i; j < n; ++j)
+                out[j] = tail[j - i];
+        }
+        return;
+    }
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, fastExp(_mm256_loadu_ps(x + i)));
+    if (i < n) {
+        __m256i m = tailMask(n - i);
+        __m256 v = _mm256_maskload_ps(x + i, m);
+        _mm256_maskstore_ps(out + i, m, fastExp(v));
+    }
+}
+
+// Inserts x into the descending list top[0..4], without branches
+inline void insertLargest( float *top, float x )
+{
+    for (int j = 0; j < 5; ++j) {
+        float higher = std::max( top[j], x );
+        x = std::min( top[j], x );
+        top[j] = higher;
+    }
+}
+
+// Merges two descending lists of 5 per lane: the k-th largest of both is
+// the largest of a[k], b[k] and min(a[i], b[j]) for i + j = k - 1.
+inline void mergeLargest( __m256 *a, const __m256 *b )
+{
+    __m256 c1 = _mm256_max_ps( _mm256_max_ps(a[1], b[1]), _mm256_min_ps(a[0], b[0]) );
+    __m256 c2 = _mm256_max_ps( _mm256_max_ps(a[2], b[2]), _mm256_max_ps( _mm256_min_ps(a[1], b[0]), _mm256_min_ps(a[0], b[1]) ) );
+    __m256 c3 = _mm256_max_ps( _mm256_max_ps(a[3], b[3]),
+                   _mm256_max_ps( _mm256_min_ps(a[2], b[0]), _mm256_max_ps( _mm256_min_ps(a[1], b[1]), _mm256_min_ps(a[0], b[2]) ) ) );
+    __m256 c4 = _mm256_max_ps( _mm256_max_ps(a[4], b[4]),
+                   _mm256_max_ps( _mm256_max_ps( _mm256_min_ps(a[3], b[0]), _mm256_min_ps(a[2], b[1]) ),
+                           _mm256_max_ps( _mm256_min_ps(a[1], b[2]), _mm256_min_ps(a[0], b[3]) ) ) );
+    a[0] = _mm256_max_ps(a[0], b[0]);
+    a[1] = c1;
+    a[2] = c2;
+    a[3] = c3;
+    a[4] = c4;
+}
+
+// Each lane keeps the 5 largest of its elements, as a cascade of
+// max / min through 5 registers; lanes are then merged pairwise.
+void largestFive( const float *x, int n, float *largest )
+{
+    for (int j = 0; j < 5; ++j)
+        largest[j] = -std::numeric_limits<float>::infinity();
+
+    int i = 0;
+    if (n >= 8)
+    {
+        __m256 top[5];
+        for (int j = 0; j < 5; ++j)
+            top[j] = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+
+        for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(x + i);
+            for (int j = 0; j < 5; ++j) {
+                __m256 higher = _mm256_max_ps(top[j], v);
+                v = _mm256_min_ps(top[j], v);
+                top[j] = higher;
+            }
+        }
+
+        __m256 other[5];
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm256_permute2f128_ps(top[j], top[j], 1);
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm256_permute_ps(top[j], _MM_SHUFFLE(1, 0, 3, 2));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm256_permute_ps(top[j], _MM_SHUFFLE(2, 3, 0, 1));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            largest[j] = _mm256_cvtss_f32(top[j]);
+    }
+
+    for (; i < n; ++i)
+        insertLargest( largest, x[i] );
+}
+
+void halfComplexPower( const float *fft, int size, float scale, float *out )
+{
+    out[0] = fft[0] * fft[0] * scale;
+
+    const __m256 s = _mm256_set1_ps(scale);
+    const __m256i reverse = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const int pairCount = (size + 1) / 2;
+    int idx = 1;
+    for (; idx + 8 <= pairCount; idx += 8) {
+        __m256 r = _mm256_loadu_ps(fft + idx);
+        __m256 i = _mm256_permutevar8x32_ps(_mm256_loadu_ps(fft + size - idx - 7), reverse);
+        __m256 p = _mm256_fmadd_ps(r, r, _mm256_mul_ps(i, i));
+        _mm256_storeu_ps(out + idx, _mm256_mul_ps(p, s));
+    }
+    for (; idx < pairCount; ++idx) {
+        float r = fft[idx];
+        float i = fft[size - idx];
+        out[idx] = (r * r + i * i) * scale;
+    }
+
+    if (size % 2 == 0)
+        out[size / 2] = fft[size / 2] * fft[size / 2] * scale;
+}
+
+void filterPanel( const float *input, int inputStride, int frames,
+                  const float *weights, int span,
+                  float *output, int outputStride )
+{
+    // blocks of 4 frames
+    for (; frames >= 4; frames -= 4) {
+        const float *in0 = input;
+        const float *in1 = input + inputStride;
+        const float *in2 = input + 2 * inputStride;
+        const float *in3 = input + 3 * inputStride;
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        for (int k = 0; k < span; ++k) {
+            __m256 w = _mm256_loadu_ps(weights + k * 8);
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(in0 + k), w, acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_broadcast_ss(in1 + k), w, acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_broadcast_ss(in2 + k), w, acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_broadcast_ss(in3 + k), w, acc3);
+        }
+        _mm256_storeu_ps(output, acc0);
+        _mm256_storeu_ps(output + outputStride, acc1);
+        _mm256_storeu_ps(output + 2 * outputStride, acc2);
+        _mm256_storeu_ps(output + 3 * outputStride, acc3);
+        input += 4 * inputStride;
+        output += 4 * outputStride;
+    }
+
+    // remaining frames
+    for (; frames > 0; --frames) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        int k = 0;
+        for (; k + 2 <= span; k += 2) {
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(input + k), _mm256_loadu_ps(weights + k * 8), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_broadcast_ss(input + k + 1), _mm256_loadu_ps(weights + k * 8 + 8), acc1);
+        }
+        if (k < span)
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(input + k), _mm256_loadu_ps(weights + k * 8), acc0);
+        _mm256_storeu_ps(output, _mm256_add_ps(acc0, acc1));
+        input += inputStride;
+        output += outputStride;
+    }
+}
+
+void fir( const float *x, const float *taps, int tapCount, float *out, int n )
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        for (int k = 0; k < tapCount; ++k) {
+            __m256 t = _mm256_broadcast_ss(taps + k);
+            s0 = _mm256_fmadd_ps(t, _mm256_loadu_ps(x + i + k), s0);
+            s1 = _mm256_fmadd_ps(t, _mm256_loadu_ps(x + i + k + 8), s1);
+        }
+        _mm256_storeu_ps(out + i, s0);
+        _mm256_storeu_ps(out + i + 8, s1);
+    }
+    for (; i < n; i += 8) {
+        __m256i m = tailMask(n - i);
+        __m256 s = _mm256_setzero_ps();
+        for (int k = 0; k < tapCount; ++k)
+            s = _mm256_fmadd_ps(_mm256_broadcast_ss(taps + k), _mm256_maskload_ps(x + i + k, m), s);
+        _mm256_maskstore_ps(out + i, m, s);
+    }
+}
+
+const Kernels s_kernels = {
+    Avx2Instructions,
+    "avx2",
+    sumOfSquares,
+    multiply,
+    dot,
+    axpy,
+    maskedMoments,
+    scale,
+    clampedSqrt,
+    clampedLog,
+    fastLog,
+    fastSqrt,
+    fastExp,
+    largestFive,
+    halfComplexPower,
+    filterPanel,
+    fir
+};
+
+} // namespace
+
+const Kernels * Detail::avx2Kernels()
+{
+    return &s_kernels;
+}
+
+} // namespace Segmenter
+
+#else
+
+const Segmenter::Kernels * Segmenter::Detail::avx2Kernels()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,557 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "kernels.hpp"
+
+#if defined(__AVX512F__) && defined(__FMA__)
+
+#include <immintrin.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace Segmenter {
+
+namespace {
+
+// Tails are handled with masked loads instead of scalar loops.
+inline __mmask16 tailMask( int remaining )
+{
+    return (__mmask16) ((1u << remaining) - 1u);
+}
+
+inline float horizontalSum( __m128 v )
+{
+    __m128 shuf = _mm_movehdup_ps(v);
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+float sumOfSquares( const float *x, int n )
+{
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+    __m512 s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512 a = _mm512_loadu_ps(x + i);
+        __m512 b = _mm512_loadu_ps(x + i + 16);
+        __m512 c = _mm512_loadu_ps(x + i + 32);
+        __m512 d = _mm512_loadu_ps(x + i + 48);
+        s0 = _mm512_fmadd_ps(a, a, s0);
+        s1 = _mm512_fmadd_ps(b, b, s1);
+        s2 = _mm512_fmadd_ps(c, c, s2);
+        s3 = _mm512_fmadd_ps(d, d, s3);
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512 a = _mm512_loadu_ps(x + i);
+        s0 = _mm512_fmadd_ps(a, a, s0);
+    }
+    if (i < n) {
+        __m512 a = _mm512_maskz_loadu_ps(tailMask(n - i), x + i);
+        s1 = _mm512_fmadd_ps(a, a, s1);
+    }
+    return _mm512_reduce_add_ps( _mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)) );
+}
+
+void multiply( const float *a, const float *b, float *out, int n )
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        _mm512_mask_storeu_ps(out + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, a + i),
+                                                        _mm512_maskz_loadu_ps(m, b + i)));
+    }
+}
+
+float dot( const float *a, const float *b, int n )
+{
+    // Shorter than one vector: 8 and 4 lanes and a scalar tail,
+    // as masked 16-lane loads cost more than they save
+    if (n < 16) {
+        __m128 s = _mm_setzero_ps();
+        int i = 0;
+        if (n >= 8) {
+            __m256 p = _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+            s = _mm_add_ps(_mm256_castps256_ps128(p), _mm256_extractf128_ps(p, 1));
+            i = 8;
+        }
+        if (i + 4 <= n) {
+            s = _mm_fmadd_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i), s);
+            i += 4;
+        }
+        float sum = horizontalSum(s);
+        for (; i < n; ++i)
+            sum += a[i] * b[i];
+        return sum;
+    }
+
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+    __m512 s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+        s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), s1);
+        s2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), s2);
+        s3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), s3);
+    }
+    for (; i + 16 <= n; i += 16)
+        s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), s1);
+    }
+    return _mm512_reduce_add_ps( _mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)) );
+}
+
+void axpy( float a, const float *x, float *y, int n )
+{
+    if (n < 16) {
+        int i = 0;
+        if (n >= 8) {
+            _mm256_storeu_ps(y, _mm256_fmadd_ps(_mm256_set1_ps(a), _mm256_loadu_ps(x), _mm256_loadu_ps(y)));
+            i = 8;
+        }
+        if (i + 4 <= n) {
+            _mm_storeu_ps(y + i, _mm_fmadd_ps(_mm_set1_ps(a), _mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+            i += 4;
+        }
+        for (; i < n; ++i)
+            y[i] += a * x[i];
+        return;
+    }
+
+    __m512 va = _mm512_set1_ps(a);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        _mm512_mask_storeu_ps(y + i, m, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(m, x + i),
+                                                        _mm512_maskz_loadu_ps(m, y + i)));
+    }
+}
+
+void maskedMoments( const float * const *x, const float *shift, int columns,
+                    const float *mask, int n, float *moments )
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.f);
+    __m512 vs[Kernels::maxMomentColumns], s[Kernels::maxMomentColumns], q[Kernels::maxMomentColumns];
+    for (int c = 0; c < columns; ++c) {
+        vs[c] = _mm512_set1_ps(shift[c]);
+        s[c] = q[c] = zero;
+    }
+    __m512 count = zero;
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 tail = n - i < 16 ? tailMask(n - i) : (__mmask16) 0xffff;
+        __mmask16 m = _mm512_mask_cmp_ps_mask(tail, _mm512_maskz_loadu_ps(tail, mask + i), zero, _CMP_NEQ_OQ);
+        count = _mm512_mask_add_ps(count, m, count, one);
+        for (int c = 0; c < columns; ++c) {
+            __m512 d = _mm512_maskz_sub_ps(m, _mm512_maskz_loadu_ps(tail, x[c] + i), vs[c]);
+            s[c] = _mm512_add_ps(s[c], d);
+            q[c] = _mm512_fmadd_ps(d, d, q[c]);
+        }
+    }
+    moments[0] = _mm512_reduce_add_ps(count);
+    for (int c = 0; c < columns; ++c) {
+        moments[1 + 2 * c] = _mm512_reduce_add_ps(s[c]);
+        moments[2 + 2 * c] = _mm512_reduce_add_ps(q[c]);
+    }
+}
+
+void scale( float a, const float *x, float *out, int n )
+{
+    __m512 va = _mm512_set1_ps(a);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(va, _mm512_loadu_ps(x + i)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        _mm512_mask_storeu_ps(out + i, m, _mm512_mul_ps(va, _mm512_maskz_loadu_ps(m, x + i)));
+    }
+}
+
+void clampedSqrt( const float *x, float floor, float *out, int n )
+{
+    __m512 f = _mm512_set1_ps(floor);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(out + i, _mm512_sqrt_ps(_mm512_max_ps(_mm512_loadu_ps(x + i), f)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        _mm512_mask_storeu_ps(out + i, m, _mm512_sqrt_ps(_mm512_max_ps(_mm512_maskz_loadu_ps(m, x + i), f)));
+    }
+}
+
+// Natural logarithm of positive normal numbers, after Cephes logf:
+// log(m * 2^e) with m in [sqrt(1/2), sqrt(2)), and a polynomial in m - 1.
+inline __m512 log( __m512 x )
+{
+    const __m512 one = _mm512_set1_ps(1.f);
+    __m512i bits = _mm512_castps_si512(x);
+    __m512 e = _mm512_cvtepi32_ps( _mm512_sub_epi32( _mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126) ) );
+    __m512 m = _mm512_castsi512_ps( _mm512_or_si512( _mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+                                                     _mm512_set1_epi32(0x3f000000) ) );
+
+    __mmask16 small = _mm512_cmp_ps_mask(m, _mm512_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+    e = _mm512_mask_sub_ps(e, small, e, one);
+    m = _mm512_mask_add_ps(_mm512_sub_ps(m, one), small, _mm512_sub_ps(m, one), m);
+
+    __m512 z = _mm512_mul_ps(m, m);
+    __m512 y = _mm512_set1_ps(7.0376836292E-2f);
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(-1.1514610310E-1f));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(1.1676998740E-1f));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(-1.2420140846E-1f));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(1.4249322787E-1f));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(-1.6668057665E-1f));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(2.0000714765E-1f));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(-2.4999993993E-1f));
+    y = _mm512_fmadd_ps(y, m, _mm512_set1_ps(3.3333331174E-1f));
+    y = _mm512_mul_ps(_mm512_mul_ps(y, m), z);
+
+    y = _mm512_fmadd_ps(e, _mm512_set1_ps(-2.12194440E-4f), y);
+    y = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), y);
+    return _mm512_fmadd_ps(e, _mm512_set1_ps(0.693359375f), _mm512_add_ps(m, y));
+}
+
+void clampedLog( const float *x, float floor, float *out, int n )
+{
+    __m512 f = _mm512_set1_ps(floor);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(out + i, log(_mm512_max_ps(_mm512_loadu_ps(x + i), f)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        __m512 v = _mm512_mask_loadu_ps(f, m, x + i);
+        _mm512_mask_storeu_ps(out + i, m, log(_mm512_max_ps(v, f)));
+    }
+}
+
+// Vector versions of the fast approximations in kernels.cpp
+
+inline __m512 fastLog( __m512 x )
+{
+    const __m512 one = _mm512_set1_ps(1.f);
+    __m512i bits = _mm512_castps_si512(x);
+    __m512 e = _mm512_cvtepi32_ps( _mm512_sub_epi32( _mm512_srli_epi32( _mm512_and_si512(bits, _mm512_set1_epi32(0x7f800000)), 23 ), _mm512_set1_epi32(127) ) );
+    __m512 m = _mm512_castsi512_ps( _mm512_or_si512( _mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f800000) ) );
+    __mmask16 large = _mm512_cmp_ps_mask(m, _mm512_set1_ps(1.41421356f), _CMP_GT_OQ);
+    m = _mm512_mask_mul_ps(m, large, m, _mm512_set1_ps(0.5f));
+    e = _mm512_mask_add_ps(e, large, e, one);
+    __m512 s = _mm512_mul_ps( _mm512_sub_ps(m, one), _mm512_rcp14_ps( _mm512_add_ps(m, one) ) );
+    __m512 s2 = _mm512_mul_ps(s, s);
+    __m512 p = _mm512_mul_ps( s, _mm512_fmadd_ps(s2, _mm512_set1_ps(0.666666667f), _mm512_set1_ps(2.f)) );
+    return _mm512_fmadd_ps(e, _mm512_set1_ps(0.693147181f), p);
+}
+
+inline __m512 fastExp( __m512 x )
+{
+    x = _mm512_min_ps( _mm512_max_ps( x, _mm512_set1_ps(-87.f) ), _mm512_set1_ps(88.f) );
+    __m512 t = _mm512_mul_ps( x, _mm512_set1_ps(1.44269504f) );
+    __m512i n = _mm512_cvtps_epi32( t );
+    __m512 f = _mm512_sub_ps( t, _mm512_cvtepi32_ps(n) );
+    __m512 p = _mm512_set1_ps(0.00961812911f);
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(0.0555041087f));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(0.240226507f));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(0.693147181f));
+    p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(1.f));
+    __m512 scale = _mm512_castsi512_ps( _mm512_slli_epi32( _mm512_add_epi32(n, _mm512_set1_epi32(127)), 23 ) );
+    return _mm512_mul_ps( p, scale );
+}
+
+inline __m128 fastExp( __m128 x )
+{
+    x = _mm_min_ps( _mm_max_ps( x, _mm_set1_ps(-87.f) ), _mm_set1_ps(88.f) );
+    __m128 t = _mm_mul_ps( x, _mm_set1_ps(1.44269504f) );
+    __m128i n = _mm_cvtps_epi32( t );
+    __m128 f = _mm_sub_ps( t, _mm_cvtepi32_ps(n) );
+    __m128 p = _mm_set1_ps(0.00961812911f);
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(0.0555041087f));
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(0.240226507f));
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(0.693147181f));
+    p = _mm_fmadd_ps(p, f, _mm_set1_ps(1.f));
+    __m128 scale = _mm_castsi128_ps( _mm_slli_epi32( _mm_add_epi32(n, _mm_set1_epi32(127)), 23 ) );
+    return _mm_mul_ps( p, scale );
+}
+
+inline __m512 fastSqrt( __m512 x )
+{
+    x = _mm512_max_ps( x, _mm512_set1_ps(1.17549435e-38f) );
+    return _mm512_mul_ps( x, _mm512_rsqrt14_ps(x) );
+}
+
+void fastLog( const float *x, float floor, float *out, int n )
+{
+    __m512 f = _mm512_set1_ps(floor);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(out + i, fastLog(_mm512_max_ps(_mm512_loadu_ps(x + i), f)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        __m512 v = _mm512_mask_loadu_ps(f, m, x + i);
+        _mm512_mask_storeu_ps(out + i, m, fastLog(_mm512_max_ps(v, f)));
+    }
+}
+
+void fastSqrt( const float *x, float floor, float *out, int n )
+{
+    __m512 f = _mm512_set1_ps(floor);
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(out + i, fastSqrt(_mm512_max_ps(_mm512_loadu_ps(x + i), f)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        __m512 v = _mm512_mask_loadu_ps(f, m, x + i);
+        _mm512_mask_storeu_ps(out + i, m, fastSqrt(_mm512_max_ps(v, f)));
+    }
+}
+
+void fastExp( const float *x, float *out, int n )
+{
+    // Shorter than one vector: 4 lanes and a copied tail, as in the SSE kernels
+    if (n < 16) {
+        int i = 0;
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(out + i, fastExp(_mm_loadu_ps(x + i)));
+        if (i < n) {
+            float tail[4];
+            for (int j = 0; j < 4; ++j)
+                tail[j] = i + j < n ? x[i + j] : 0.f;
+            _mm_storeu_ps(tail, fastExp(_mm_loadu_ps(tail)));
+            for (int j = i; j < n; ++j)
+                out[j] = tail[j - i];
+        }
+        return;
+    }
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16)
+        _mm512_storeu_ps(out + i, fastExp(_mm512_loadu_ps(x + i)));
+    if (i < n) {
+        __mmask16 m = tailMask(n - i);
+        __m512 v = _mm512_mask_loadu_ps(_mm512_setzero_ps(), m, x + i);
+        _mm512_mask_storeu_ps(out + i, m, fastExp(v));
+    }
+}
+
+// Inserts x into the descending list top[0..4], without branches
+inline void insertLargest( float *top, float x )
+{
+    for (int j = 0; j < 5; ++j) {
+        float higher = std::max( top[j], x );
+        x = std::min( top[j], x );
+        top[j] = higher;
+    }
+}
+
+// Merges two descending lists of 5 per lane: the k-th largest of both is
+// the largest of a[k], b[k] and min(a[i], b[j]) for i + j = k - 1.
+inline void mergeLargest( __m512 *a, const __m512 *b )
+{
+    __m512 c1 = _mm512_max_ps( _mm512_max_ps(a[1], b[1]), _mm512_min_ps(a[0], b[0]) );
+    __m512 c2 = _mm512_max_ps( _mm512_max_ps(a[2], b[2]), _mm512_max_ps( _mm512_min_ps(a[1], b[0]), _mm512_min_ps(a[0], b[1]) ) );
+    __m512 c3 = _mm512_max_ps( _mm512_max_ps(a[3], b[3]),
+                   _mm512_max_ps( _mm512_min_ps(a[2], b[0]), _mm512_max_ps( _mm512_min_ps(a[1], b[1]), _mm512_min_ps(a[0], b[2]) ) ) );
+    __m512 c4 = _mm512_max_ps( _mm512_max_ps(a[4], b[4]),
+                   _mm512_max_ps( _mm512_max_ps( _mm512_min_ps(a[3], b[0]), _mm512_min_ps(a[2], b[1]) ),
+                           _mm512_max_ps( _mm512_min_ps(a[1], b[2]), _mm512_min_ps(a[0], b[3]) ) ) );
+    a[0] = _mm512_max_ps(a[0], b[0]);
+    a[1] = c1;
+    a[2] = c2;
+    a[3] = c3;
+    a[4] = c4;
+}
+
+// Each lane keeps the 5 largest of its elements, as a cascade of
+// max / min through 5 registers; lanes are then merged pairwise.
+void largestFive( const float *x, int n, float *largest )
+{
+    for (int j = 0; j < 5; ++j)
+        largest[j] = -std::numeric_limits<float>::infinity();
+
+    int i = 0;
+    if (n >= 16)
+    {
+        __m512 top[5];
+        for (int j = 0; j < 5; ++j)
+            top[j] = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+
+        for (; i + 16 <= n; i += 16) {
+            __m512 v = _mm512_loadu_ps(x + i);
+            for (int j = 0; j < 5; ++j) {
+                __m512 higher = _mm512_max_ps(top[j], v);
+                v = _mm512_min_ps(top[j], v);
+                top[j] = higher;
+            }
+        }
+
+        __m512 other[5];
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm512_shuffle_f32x4(top[j], top[j], _MM_SHUFFLE(1, 0, 3, 2));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm512_shuffle_f32x4(top[j], top[j], _MM_SHUFFLE(2, 3, 0, 1));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm512_permute_ps(top[j], _MM_SHUFFLE(1, 0, 3, 2));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm512_permute_ps(top[j], _MM_SHUFFLE(2, 3, 0, 1));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            largest[j] = _mm512_cvtss_f32(top[j]);
+    }
+
+    for (; i < n; ++i)
+        insertLargest( largest, x[i] );
+}
+
+void halfComplexPower( const float *fft, int size, float scale, float *out )
+{
+    out[0] = fft[0] * fft[0] * scale;
+
+    const __m512 s = _mm512_set1_ps(scale);
+    const __m512i reverse = _mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const int pairCount = (size + 1) / 2;
+    int idx = 1;
+    for (; idx + 16 <= pairCount; idx += 16) {
+        __m512 r = _mm512_loadu_ps(fft + idx);
+        __m512 i = _mm512_permutexvar_ps(reverse, _mm512_loadu_ps(fft + size - idx - 15));
+        __m512 p = _mm512_fmadd_ps(r, r, _mm512_mul_ps(i, i));
+        _mm512_storeu_ps(out + idx, _mm512_mul_ps(p, s));
+    }
+    for (; idx < pairCount; ++idx) {
+        float r = fft[idx];
+        float i = fft[size - idx];
+        out[idx] = (r * r + i * i) * scale;
+    }
+
+    if (size % 2 == 0)
+        out[size / 2] = fft[size / 2] * fft[size / 2] * scale;
+}
+
+// The panel width matches 256-bit registers; 512-bit ones would need
+// a wider panel layout for no gain at our filter counts.
+void filterPanel( const float *input, int inputStride, int frames,
+                  const float *weights, int span,
+                  float *output, int outputStride )
+{
+    // blocks of 4 frames
+    for (; frames >= 4; frames -= 4) {
+        const float *in0 = input;
+        const float *in1 = input + inputStride;
+        const float *in2 = input + 2 * inputStride;
+        const float *in3 = input + 3 * inputStride;
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        for (int k = 0; k < span; ++k) {
+            __m256 w = _mm256_loadu_ps(weights + k * 8);
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(in0 + k), w, acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_broadcast_ss(in1 + k), w, acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_broadcast_ss(in2 + k), w, acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_broadcast_ss(in3 + k), w, acc3);
+        }
+        _mm256_storeu_ps(output, acc0);
+        _mm256_storeu_ps(output + outputStride, acc1);
+        _mm256_storeu_ps(output + 2 * outputStride, acc2);
+        _mm256_storeu_ps(output + 3 * outputStride, acc3);
+        input += 4 * inputStride;
+        output += 4 * outputStride;
+    }
+
+    // remaining frames
+    for (; frames > 0; --frames) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        int k = 0;
+        for (; k + 2 <= span; k += 2) {
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(input + k), _mm256_loadu_ps(weights + k * 8), acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_broadcast_ss(input + k + 1), _mm256_loadu_ps(weights + k * 8 + 8), acc1);
+        }
+        if (k < span)
+            acc0 = _mm256_fmadd_ps(_mm256_broadcast_ss(input + k), _mm256_loadu_ps(weights + k * 8), acc0);
+        _mm256_storeu_ps(output, _mm256_add_ps(acc0, acc1));
+        input += inputStride;
+        output += outputStride;
+    }
+}
+
+void fir( const float *x, const float *taps, int tapCount, float *out, int n )
+{
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+        for (int k = 0; k < tapCount; ++k) {
+            __m512 t = _mm512_set1_ps(taps[k]);
+            s0 = _mm512_fmadd_ps(t, _mm512_loadu_ps(x + i + k), s0);
+            s1 = _mm512_fmadd_ps(t, _mm512_loadu_ps(x + i + k + 16), s1);
+        }
+        _mm512_storeu_ps(out + i, s0);
+        _mm512_storeu_ps(out + i + 16, s1);
+    }
+    for (; i < n; i += 16) {
+        __mmask16 m = n - i < 16 ? tailMask(n - i) : (__mmask16) 0xffff;
+        __m512 s = _mm512_setzero_ps();
+        for (int k = 0; k < tapCount; ++k)
+            s = _mm512_fmadd_ps(_mm512_set1_ps(taps[k]), _mm512_maskz_loadu_ps(m, x + i + k), s);
+        _mm512_mask_storeu_ps(out + i, m, s);
+    }
+}
+
+const Kernels s_kernels = {
+    Avx512Instructions,
+    "avx512",
+    sumOfSquares,
+    multiply,
+    dot,
+    axpy,
+    maskedMoments,
+    scale,
+    clampedSqrt,
+    clampedLog,
+    fastLog,
+    fastSqrt,
+    fastExp,
+    largestFive,
+    halfComplexPower,
+    filterPanel,
+    fir
+};
+
+} // namespace
+
+const Kernels * Detail::avx512Kernels()
+{
+    return &s_kernels;
+}
+
+} // namespace Segmenter
+
+#else
+
+const Segmenter::Kernels * Segmenter::Detail::avx512Kernels()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,486 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "kernels.hpp"
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace Segmenter {
+
+namespace {
+
+inline float horizontalSum( __m128 v )
+{
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+float sumOfSquares( const float *x, int n )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128 a = _mm_loadu_ps(x + i);
+        __m128 b = _mm_loadu_ps(x + i + 4);
+        __m128 c = _mm_loadu_ps(x + i + 8);
+        __m128 d = _mm_loadu_ps(x + i + 12);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(a, a));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(b, b));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(c, c));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(d, d));
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(x + i);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(a, a));
+    }
+    float s = horizontalSum( _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)) );
+    for (; i < n; ++i)
+        s += x[i] * x[i];
+    return s;
+}
+
+void multiply( const float *a, const float *b, float *out, int n )
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i < n; ++i)
+        out[i] = a[i] * b[i];
+}
+
+float dot( const float *a, const float *b, int n )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(a + i + 8), _mm_loadu_ps(b + i + 8)));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(a + i + 12), _mm_loadu_ps(b + i + 12)));
+    }
+    for (; i + 4 <= n; i += 4)
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    float s = horizontalSum( _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)) );
+    for (; i < n; ++i)
+        s += a[i] * b[i];
+    return s;
+}
+
+void axpy( float a, const float *x, float *y, int n )
+{
+    __m128 va = _mm_set1_ps(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+    for (; i < n; ++i)
+        y[i] += a * x[i];
+}
+
+void maskedMoments( const float * const *x, const float *shift, int columns,
+                    const float *mask, int n, float *moments )
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    __m128 vs[Kernels::maxMomentColumns], s[Kernels::maxMomentColumns], q[Kernels::maxMomentColumns];
+    for (int c = 0; c < columns; ++c) {
+        vs[c] = _mm_set1_ps(shift[c]);
+        s[c] = q[c] = zero;
+    }
+    __m128 count = zero;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 m = _mm_cmpneq_ps(_mm_loadu_ps(mask + i), zero);
+        count = _mm_add_ps(count, _mm_and_ps(m, one));
+        for (int c = 0; c < columns; ++c) {
+            __m128 d = _mm_and_ps(m, _mm_sub_ps(_mm_loadu_ps(x[c] + i), vs[c]));
+            s[c] = _mm_add_ps(s[c], d);
+            q[c] = _mm_add_ps(q[c], _mm_mul_ps(d, d));
+        }
+    }
+    moments[0] = horizontalSum(count);
+    for (int c = 0; c < columns; ++c) {
+        moments[1 + 2 * c] = horizontalSum(s[c]);
+        moments[2 + 2 * c] = horizontalSum(q[c]);
+    }
+    for (; i < n; ++i) {
+        const bool gated = mask[i] != 0.f;
+        moments[0] += gated ? 1.f : 0.f;
+        for (int c = 0; c < columns; ++c) {
+            float d = gated ? x[c][i] - shift[c] : 0.f;
+            moments[1 + 2 * c] += d;
+            moments[2 + 2 * c] += d * d;
+        }
+    }
+}
+
+void scale( float a, const float *x, float *out, int n )
+{
+    __m128 va = _mm_set1_ps(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+    for (; i < n; ++i)
+        out[i] = a * x[i];
+}
+
+void clampedSqrt( const float *x, float floor, float *out, int n )
+{
+    __m128 f = _mm_set1_ps(floor);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_max_ps(_mm_loadu_ps(x + i), f)));
+    for (; i < n; ++i)
+        out[i] = std::sqrt( x[i] > floor ? x[i] : floor );
+}
+
+// Natural logarithm of positive normal numbers, after Cephes logf:
+// log(m * 2^e) with m in [sqrt(1/2), sqrt(2)), and a polynomial in m - 1.
+inline __m128 log( __m128 x )
+{
+    const __m128 one = _mm_set1_ps(1.f);
+    __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps( _mm_sub_epi32( _mm_srli_epi32(bits, 23), _mm_set1_epi32(126) ) );
+    __m128 m = _mm_castsi128_ps( _mm_or_si128( _mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                               _mm_set1_epi32(0x3f000000) ) );
+
+    __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+    e = _mm_sub_ps(e, _mm_and_ps(one, small));
+    m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(m, small));
+
+    __m128 z = _mm_mul_ps(m, m);
+    __m128 y = _mm_set1_ps(7.0376836292E-2f);
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.1514610310E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.1676998740E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.2420140846E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.4249322787E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.6668057665E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(2.0000714765E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-2.4999993993E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(3.3333331174E-1f));
+    y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+
+    y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440E-4f)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+}
+
+void clampedLog( const float *x, float floor, float *out, int n )
+{
+    __m128 f = _mm_set1_ps(floor);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, log(_mm_max_ps(_mm_loadu_ps(x + i), f)));
+    if (i < n) {
+        // same approximation for the tail
+        float tail[4];
+        for (int j = 0; j < 4; ++j)
+            tail[j] = i + j < n ? x[i + j] : floor;
+        _mm_storeu_ps(tail, log(_mm_max_ps(_mm_loadu_ps(tail), f)));
+        for (int j = i; j < n; ++j)
+            out[j] = tail[j - i];
+    }
+}
+
+// Vector versions of the fast approximations in kernels.cpp
+
+inline __m128 fastLog( __m128 x )
+{
+    const __m128 one = _mm_set1_ps(1.f);
+    __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps( _mm_sub_epi32( _mm_srli_epi32( _mm_and_si128(bits, _mm_set1_epi32(0x7f800000)), 23 ), _mm_set1_epi32(127) ) );
+    __m128 m = _mm_castsi128_ps( _mm_or_si128( _mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000) ) );
+    __m128 large = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+    m = _mm_sub_ps( m, _mm_and_ps( large, _mm_mul_ps(m, _mm_set1_ps(0.5f)) ) );
+    e = _mm_add_ps( e, _mm_and_ps( large, one ) );
+    __m128 s = _mm_mul_ps( _mm_sub_ps(m, one), _mm_rcp_ps( _mm_add_ps(m, one) ) );
+    __m128 s2 = _mm_mul_ps(s, s);
+    __m128 p = _mm_mul_ps( s, _mm_add_ps(_mm_mul_ps(s2, _mm_set1_ps(0.666666667f)), _mm_set1_ps(2.f)) );
+    return _mm_add_ps(_mm_mul_ps(e, _mm_set1_ps(0.693147181f)), p);
+}
+
+inline __m128 fastExp( __m128 x )
+{
+    x = _mm_min_ps( _mm_max_ps( x, _mm_set1_ps(-87.f) ), _mm_set1_ps(88.f) );
+    __m128 t = _mm_mul_ps( x, _mm_set1_ps(1.44269504f) );
+    __m128i n = _mm_cvtps_epi32( t );
+    __m128 f = _mm_sub_ps( t, _mm_cvtepi32_ps(n) );
+    __m128 p = _mm_set1_ps(0.00961812911f);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.0555041087f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.240226507f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.693147181f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.f));
+    __m128 scale = _mm_castsi128_ps( _mm_slli_epi32( _mm_add_epi32(n, _mm_set1_epi32(127)), 23 ) );
+    return _mm_mul_ps( p, scale );
+}
+
+inline __m128 fastSqrt( __m128 x )
+{
+    x = _mm_max_ps( x, _mm_set1_ps(1.17549435e-38f) );
+    return _mm_mul_ps( x, _mm_rsqrt_ps(x) );
+}
+
+void fastLog( const float *x, float floor, float *out, int n )
+{
+    __m128 f = _mm_set1_ps(floor);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, fastLog(_mm_max_ps(_mm_loadu_ps(x + i), f)));
+    if (i < n) {
+        float tail[4];
+        for (int j = 0; j < 4; ++j)
+            tail[j] = i + j < n ? x[i + j] : floor;
+        _mm_storeu_ps(tail, fastLog(_mm_max_ps(_mm_loadu_ps(tail), f)));
+        for (int j = i; j < n; ++j)
+            out[j] = tail[j - i];
+    }
+}
+
+void fastSqrt( const float *x, float floor, float *out, int n )
+{
+    __m128 f = _mm_set1_ps(floor);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, fastSqrt(_mm_max_ps(_mm_loadu_ps(x + i), f)));
+    if (i < n) {
+        float tail[4];
+        for (int j = 0; j < 4; ++j)
+            tail[j] = i + j < n ? x[i + j] : floor;
+        _mm_storeu_ps(tail, fastSqrt(_mm_max_ps(_mm_loadu_ps(tail), f)));
+        for (int j = i; j < n; ++j)
+            out[j] = tail[j - i];
+    }
+}
+
+void fastExp( const float *x, float *out, int n )
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, fastExp(_mm_loadu_ps(x + i)));
+    if (i < n) {
+        float tail[4];
+        for (int j = 0; j < 4; ++j)
+            tail[j] = i + j < n ? x[i + j] : 0.f;
+        _mm_storeu_ps(tail, fastExp(_mm_loadu_ps(tail)));
+        for (int j = i; j < n; ++j)
+            out[j] = tail[j - i];
+    }
+}
+
+// Inserts x into the descending list top[0..4], without branches
+inline void insertLargest( float *top, float x )
+{
+    for (int j = 0; j < 5; ++j) {
+        float higher = std::max( top[j], x );
+        x = std::min( top[j], x );
+        top[j] = higher;
+    }
+}
+
+// Merges two descending lists of 5 per lane: the k-th largest of both is
+// the largest of a[k], b[k] and min(a[i], b[j]) for i + j = k - 1.
+inline void mergeLargest( __m128 *a, const __m128 *b )
+{
+    __m128 c1 = _mm_max_ps( _mm_max_ps(a[1], b[1]), _mm_min_ps(a[0], b[0]) );
+    __m128 c2 = _mm_max_ps( _mm_max_ps(a[2], b[2]), _mm_max_ps( _mm_min_ps(a[1], b[0]), _mm_min_ps(a[0], b[1]) ) );
+    __m128 c3 = _mm_max_ps( _mm_max_ps(a[3], b[3]),
+                   _mm_max_ps( _mm_min_ps(a[2], b[0]), _mm_max_ps( _mm_min_ps(a[1], b[1]), _mm_min_ps(a[0], b[2]) ) ) );
+    __m128 c4 = _mm_max_ps( _mm_max_ps(a[4], b[4]),
+                   _mm_max_ps( _mm_max_ps( _mm_min_ps(a[3], b[0]), _mm_min_ps(a[2], b[1]) ),
+                           _mm_max_ps( _mm_min_ps(a[1], b[2]), _mm_min_ps(a[0], b[3]) ) ) );
+    a[0] = _mm_max_ps(a[0], b[0]);
+    a[1] = c1;
+    a[2] = c2;
+    a[3] = c3;
+    a[4] = c4;
+}
+
+// Each lane keeps the 5 largest of its elements, as a cascade of
+// max / min through 5 registers; lanes are then merged pairwise.
+void largestFive( const float *x, int n, float *largest )
+{
+    for (int j = 0; j < 5; ++j)
+        largest[j] = -std::numeric_limits<float>::infinity();
+
+    int i = 0;
+    if (n >= 4)
+    {
+        __m128 top[5];
+        for (int j = 0; j < 5; ++j)
+            top[j] = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(x + i);
+            for (int j = 0; j < 5; ++j) {
+                __m128 higher = _mm_max_ps(top[j], v);
+                v = _mm_min_ps(top[j], v);
+                top[j] = higher;
+            }
+        }
+
+        __m128 other[5];
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm_shuffle_ps(top[j], top[j], _MM_SHUFFLE(1, 0, 3, 2));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            other[j] = _mm_shuffle_ps(top[j], top[j], _MM_SHUFFLE(2, 3, 0, 1));
+        mergeLargest( top, other );
+        for (int j = 0; j < 5; ++j)
+            largest[j] = _mm_cvtss_f32(top[j]);
+    }
+
+    for (; i < n; ++i)
+        insertLargest( largest, x[i] );
+}
+
+void halfComplexPower( const float *fft, int size, float scale, float *out )
+{
+    out[0] = fft[0] * fft[0] * scale;
+
+    const __m128 s = _mm_set1_ps(scale);
+    const int pairCount = (size + 1) / 2;
+    int idx = 1;
+    for (; idx + 4 <= pairCount; idx += 4) {
+        __m128 r = _mm_loadu_ps(fft + idx);
+        __m128 i = _mm_loadu_ps(fft + size - idx - 3);
+        i = _mm_shuffle_ps(i, i, _MM_SHUFFLE(0, 1, 2, 3));
+        __m128 p = _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i));
+        _mm_storeu_ps(out + idx, _mm_mul_ps(p, s));
+    }
+    for (; idx < pairCount; ++idx) {
+        float r = fft[idx];
+        float i = fft[size - idx];
+        out[idx] = (r * r + i * i) * scale;
+    }
+
+    if (size % 2 == 0)
+        out[size / 2] = fft[size / 2] * fft[size / 2] * scale;
+}
+
+void filterPanel( const float *input, int inputStride, int frames,
+                  const float *weights, int span,
+                  float *output, int outputStride )
+{
+    // blocks of 2 frames
+    for (; frames >= 2; frames -= 2) {
+        const float *in0 = input;
+        const float *in1 = input + inputStride;
+        __m128 lo0 = _mm_setzero_ps(), hi0 = _mm_setzero_ps();
+        __m128 lo1 = _mm_setzero_ps(), hi1 = _mm_setzero_ps();
+        for (int k = 0; k < span; ++k) {
+            __m128 wlo = _mm_loadu_ps(weights + k * 8);
+            __m128 whi = _mm_loadu_ps(weights + k * 8 + 4);
+            __m128 x0 = _mm_set1_ps(in0[k]);
+            __m128 x1 = _mm_set1_ps(in1[k]);
+            lo0 = _mm_add_ps(lo0, _mm_mul_ps(x0, wlo));
+            hi0 = _mm_add_ps(hi0, _mm_mul_ps(x0, whi));
+            lo1 = _mm_add_ps(lo1, _mm_mul_ps(x1, wlo));
+            hi1 = _mm_add_ps(hi1, _mm_mul_ps(x1, whi));
+        }
+        _mm_storeu_ps(output, lo0);
+        _mm_storeu_ps(output + 4, hi0);
+        _mm_storeu_ps(output + outputStride, lo1);
+        _mm_storeu_ps(output + outputStride + 4, hi1);
+        input += 2 * inputStride;
+        output += 2 * outputStride;
+    }
+
+    // remaining frame
+    if (frames > 0) {
+        __m128 lo = _mm_setzero_ps(), hi = _mm_setzero_ps();
+        for (int k = 0; k < span; ++k) {
+            __m128 x = _mm_set1_ps(input[k]);
+            lo = _mm_add_ps(lo, _mm_mul_ps(x, _mm_loadu_ps(weights + k * 8)));
+            hi = _mm_add_ps(hi, _mm_mul_ps(x, _mm_loadu_ps(weights + k * 8 + 4)));
+        }
+        _mm_storeu_ps(output, lo);
+        _mm_storeu_ps(output + 4, hi);
+    }
+}
+
+void fir( const float *x, const float *taps, int tapCount, float *out, int n )
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+        for (int k = 0; k < tapCount; ++k) {
+            __m128 t = _mm_set1_ps(taps[k]);
+            s0 = _mm_add_ps(s0, _mm_mul_ps(t, _mm_loadu_ps(x + i + k)));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(t, _mm_loadu_ps(x + i + k + 4)));
+        }
+        _mm_storeu_ps(out + i, s0);
+        _mm_storeu_ps(out + i + 4, s1);
+    }
+    for (; i < n; ++i) {
+        float s = 0.f;
+        for (int k = 0; k < tapCount; ++k)
+            s += taps[k] * x[i + k];
+        out[i] = s;
+    }
+}
+
+const Kernels s_kernels = {
+    SseInstructions,
+    "sse",
+    sumOfSquares,
+    multiply,
+    dot,
+    axpy,
+    maskedMoments,
+    scale,
+    clampedSqrt,
+    clampedLog,
+    fastLog,
+    fastSqrt,
+    fastExp,
+    largestFive,
+    halfComplexPower,
+    filterPanel,
+    fir
+};
+
+} // namespace
+
+const Kernels * Detail::sseKernels()
+{
+    return &s_kernels;
+}
+
+} // namespace Segmenter
+
+#else
+
+const Segmenter::Kernels * Segmenter::Detail::sseKernels()
+{
+    return 0;
+}
+
+#endif
@@ -22,21 +22,18 @@
 #define SEGMENTER_MEL_SPECTRUM_INCLUDED
 
 #include "module.hpp"
+#include "filter_bank.hpp"
+#include "tables.hpp"
 
 #include <vector>
 #include <cmath>
+#include <cstring>
 
 namespace Segmenter {
 
 class MelSpectrum : public Module
 {
-    struct Filter {
-        int offset;
-        std::vector<float> coeff;
-    };
-
-    std::vector<Filter> m_melFilterBank;
-    std::vector<float> m_input;
+    Tables::FilterBankTable m_filterBank;
     std::vector<float> m_output;
 
 public:
@@ -45,38 +42,36 @@ public:
         //const double fh = 0.5;
         const double fh = 11025*0.5/sampleRate;
         const double fl = 0;
-        initMelFilters(coefficientCount, windowSize, sampleRate, fl, fh, m_melFilterBank);
+        m_filterBank = Tables::melFilterBank( coefficientCount, windowSize, sampleRate, fl, fh );
 
-        m_input.resize(windowSize / 2 + 1);
         m_output.resize(coefficientCount);
     }
 
     void process( const std::vector<float> & spectrumMagnitude )
     {
-        const int filterBankSize = m_melFilterBank.size();
-
-        for (int filterIdx = 0; filterIdx < filterBankSize; ++filterIdx)
-        {
-            const Filter & filter = m_melFilterBank[filterIdx];
-            const int coeffCount = filter.coeff.size();
-
-            float filterOut = 0;
-
-            for (int idx = 0; idx < coeffCount; ++idx)
-                filterOut += filter.coeff[idx] * spectrumMagnitude[filter.offset + idx];
+        m_filterBank->process( spectrumMagnitude.data(), m_output.data() );
+    }
 
-            m_output[filterIdx] = filterOut;
-        }
+    // Takes the output of filterBank(), applied elsewhere.
+    void processFiltered( const float * bands )
+    {
+        std::memcpy( m_output.data(), bands, m_output.size() * sizeof(float) );
     }
 
     const std::vector<float> & output() const { return m_output; }
 
-private:
+    const SparseFilterBank & filterBank() const { return *m_filterBank; }
+
+    // Spectrum bins read by process()
+    BinRange inputRange() const { return m_filterBank->inputRange(); }
+
     static void initMelFilters(int p, int n, int fs, double fl, double fh,
-                               std::vector<Filter> & filterBank)
-                               //int * p_offsets, std::vector<float> * p_values)
+                               SparseFilterBank & filterBank)
     {
-        filterBank.resize(p);
+        filterBank = SparseFilterBank( n / 2 + 1 );
+
+        std::vector<int> offsets(p, -1);
+        std::vector< std::vector<float> > coeffs(p);
 
         double f0 = 700.0 / fs;
         int fn2 = (int) std::floor(n / 2.0);
@@ -109,24 +104,22 @@ private:
         int k3 = b3 - b1;
         int k4 = b4 - b1;
 
-        for (int idx = 0; idx < p; ++idx) {
-            filterBank[idx].offset = -1;
-            filterBank[idx].coeff.clear();
-        }
-
         for (int idx = 0; idx <= k3; ++idx)
         {
-            Filter & filt = filterBank[ fp[idx] ];
-            filt.offset = (filt.offset == -1 ? idx + b1 : filt.offset);
-            filt.coeff.push_back((float)(2 * pm[idx]));
+            int filt = fp[idx];
+            offsets[filt] = (offsets[filt] == -1 ? idx + b1 : offsets[filt]);
+            coeffs[filt].push_back((float)(2 * pm[idx]));
         }
         for (int idx = k2; idx <= k4; idx++)
         {
-            Filter & filt = filterBank[ fp[idx] - 1 ];
-            filt.offset = (filt.offset == -1 ? idx + b1 : filt.offset);
-            filt.coeff.push_back((float)(2 * (1 - pm[idx])));
+            int filt = fp[idx] - 1;
+            offsets[filt] = (offsets[filt] == -1 ? idx + b1 : offsets[filt]);
+            coeffs[filt].push_back((float)(2 * (1 - pm[idx])));
         }
 
+        for (int idx = 0; idx < p; ++idx)
+            filterBank.addFilter( offsets[idx], coeffs[idx].data(), coeffs[idx].size() );
+
         delete[] pf;
         delete[] fp;
         delete[] pm;
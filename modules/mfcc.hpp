@@ -22,60 +22,100 @@
 #define SEGMENTER_MFCC_HPP_INCLUDED
 
 #include "module.hpp"
+#include "kernels.hpp"
+#include "tables.hpp"
 
 #include <vector>
 #include <cmath>
-#include <fftw3.h>
+#include <cstring>
+#include <cassert>
+#include "fft.hpp"
 
 namespace Segmenter {
 
+/*
+    Mel-frequency cepstral coefficients: DCT-II of the log mel spectrum.
+
+    If only some coefficients are requested, they are computed as
+    dot products with precomputed cosine rows instead of a full DCT,
+    and the other elements of output() stay zero.
+*/
 class Mfcc : public Module
 {
-    fftwf_plan m_plan;
-    float *m_dctIn;
-    float *m_dctOut;
+    RealTransform *m_transform;
+
+    std::vector<int> m_coefficients;
+    Tables::FloatTable m_cosineRows;
+    std::vector<float> m_logSpectrum;
 
     std::vector<float> m_output;
 
     float m_outputScale;
 
+    MathContext::Precision m_precision;
+
 public:
-    Mfcc( int coefficientCount )
+    Mfcc( int coefficientCount, const std::vector<int> & coefficients = std::vector<int>(),
+          MathContext::Precision precision = MathContext::Accurate ):
+        m_transform(0),
+        m_coefficients(coefficients),
+        m_precision(precision)
     {
-        m_dctIn = fftwf_alloc_real(coefficientCount);
-        m_dctOut = fftwf_alloc_real(coefficientCount);
-        m_plan = fftwf_plan_r2r_1d(coefficientCount, m_dctIn, m_dctOut,
-                                   FFTW_REDFT10, FFTW_ESTIMATE);
+        if (m_coefficients.empty())
+        {
+            m_transform = createTransform( RealTransform::Dct2, coefficientCount );
+        }
+        else
+        {
+            // Rows of FFTW's REDFT10, with the first one scaled as in process()
+            for (int row = 0; row < (int) m_coefficients.size(); ++row)
+                assert( m_coefficients[row] >= 0 && m_coefficients[row] < coefficientCount );
+            m_cosineRows = Tables::cosineRows( coefficientCount, m_coefficients, 2.0 );
+        }
 
-        m_output.resize(coefficientCount);
+        m_logSpectrum.resize(coefficientCount);
+        m_output.resize(coefficientCount, 0.f);
 
         m_outputScale = 1.f / std::sqrt( 2.0f * coefficientCount );
     }
 
     ~Mfcc()
     {
-        fftwf_free(m_dctIn);
-        fftwf_free(m_dctOut);
-        fftwf_destroy_plan(m_plan);
+        delete m_transform;
     }
 
     void process ( const std::vector<float> & melSpectrum )
     {
         static const float ath = 1.0f/65536;
         const int coeffCount = melSpectrum.size();
+        const Kernels & k = kernels();
+        void (*log)( const float *, float, float *, int ) =
+            m_precision == MathContext::Fast ? k.fastLog : k.clampedLog;
 
-        for (int idx = 0; idx < coeffCount; ++idx)
+        if (m_transform)
         {
-            m_dctIn[idx] = std::log( std::max(ath, melSpectrum[idx]) );
-        }
+            log( melSpectrum.data(), ath, m_transform->input(), coeffCount );
 
-        fftwf_execute( m_plan );
+            m_transform->execute();
 
-        m_dctOut[0] /= sqrt(2.0f);
-        std::memcpy( m_output.data(), m_dctOut, sizeof(float) * coeffCount );
+            std::memcpy( m_output.data(), m_transform->output(), sizeof(float) * coeffCount );
+            m_output[0] /= sqrt(2.0f);
+        }
+        else
+        {
+            log( melSpectrum.data(), ath, m_logSpectrum.data(), coeffCount );
+
+            for (int row = 0; row < (int) m_coefficients.size(); ++row) {
+                m_output[m_coefficients[row]] =
+                    k.dot( m_cosineRows->data() + row * coeffCount, m_logSpectrum.data(), coeffCount );
+            }
+        }
     }
 
     const std::vector<float> & output() const { return m_output; }
+
+    // Computed coefficients; empty if all are computed
+    const std::vector<int> & coefficients() const { return m_coefficients; }
 };
 
 } // namespace Segmenter
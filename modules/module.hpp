@@ -22,6 +22,7 @@
 #define SEGMENTER_MODULE_HPP_INCLUDED
 
 #include <cmath>
+#include <algorithm>
 
 namespace Segmenter {
 
@@ -32,10 +33,63 @@ struct FourierContext {
     int stepSize;
 };
 
+// Half-open range of spectrum bins [begin, end)
+struct BinRange
+{
+    BinRange(): begin(0), end(0) {}
+    BinRange( int begin, int end ): begin(begin), end(end) {}
+    int begin;
+    int end;
+
+    int size() const { return end > begin ? end - begin : 0; }
+    bool empty() const { return end <= begin; }
+
+    // Extends the range to cover 'other' as well
+    BinRange & operator|= ( const BinRange & other )
+    {
+        if (other.empty())
+            return *this;
+        if (empty())
+            return *this = other;
+        begin = std::min( begin, other.begin );
+        end = std::max( end, other.end );
+        return *this;
+    }
+};
+
 struct StatisticContext
 {
+    StatisticContext(): blockSize(0), stepSize(0), deltaBlockSize(5), lookahead(-1),
+        incremental(false), featureIndex(false) {}
     int blockSize;
     int stepSize;
+    // Frames of the linear regression of delta features
+    int deltaBlockSize;
+    // Causal statistics: frames after its own that the statistics of a frame
+    // may use, up to blockSize / 2. If negative, statistics are centred.
+    int lookahead;
+    // Update gated sums as frames enter and leave the window,
+    // instead of summing each window anew
+    bool incremental;
+    // Build a FeatureIndex of all frames, for statistics of arbitrary ranges
+    bool featureIndex;
+};
+
+// Choice between accurate math functions and the fast approximations
+// of Kernels, for each module that evaluates them per frame
+struct MathContext
+{
+    enum Precision { Accurate, Fast };
+
+    MathContext( Precision precision = Accurate ):
+        magnitude(precision), mfcc(precision), entropy(precision),
+        cepstrum(precision), classifier(precision) {}
+
+    Precision magnitude;  // sqrt of power spectrum
+    Precision mfcc;       // log of mel spectrum
+    Precision entropy;    // log of chromatic spectrum
+    Precision cepstrum;   // sqrt of magnitude spectrum
+    Precision classifier; // exp of class scores
 };
 
 class Module
@@ -32,52 +32,149 @@
 #include "4hz_modulation.hpp"
 #include "statistics.hpp"
 #include "classification.hpp"
+#include "kernels.hpp"
 
 namespace Segmenter {
 
 Pipeline::Pipeline ( const InputContext & inCtx,
                      const FourierContext & fCtx,
-                     const StatisticContext & statCtx):
+                     const StatisticContext & statCtx,
+                     const MathContext & mathCtx ):
+    Pipeline( inCtx, fCtx, std::vector<StatisticContext>(1, statCtx), mathCtx )
+{}
+
+Pipeline::Pipeline ( const InputContext & inCtx,
+                     const FourierContext & fCtx,
+                     const std::vector<StatisticContext> & statCtxs,
+                     const MathContext & mathCtx ):
     m_inputContext( inCtx ),
     m_fourierContext( fCtx ),
-    m_statContext( statCtx ),
-    m_last_classification(0.f),
-    m_resample( inCtx.sampleRate != fCtx.sampleRate )
+    m_mathContext( mathCtx ),
+    m_buildFeatureIndex( false ),
+    m_resample( inCtx.sampleRate != fCtx.sampleRate ),
+    m_nativeRate( false ),
+    m_frameSize( fCtx.blockSize ),
+    m_frameStep( fCtx.stepSize ),
+    m_framePosition( 0.0 )
 {
     InputContext & in = m_inputContext;
     FourierContext & fourier = m_fourierContext;
-    StatisticContext & stat = m_statContext;
+    const MathContext & math = m_mathContext;
 
-    m_statsStepDuration = Vamp::RealTime::fromSeconds
-        ( (double) stat.stepSize * m_fourierContext.stepSize / m_fourierContext.sampleRate );
-    m_statsTime = Vamp::RealTime::fromSeconds
-        ( ((double) stat.blockSize / 2.0) * m_fourierContext.stepSize / m_fourierContext.sampleRate );
+    if (m_resample && in.frontEnd == InputContext::NativeRateFrontEnd)
+    {
+        if (in.sampleRate > fourier.sampleRate) {
+            // Frames span the same time as at the analysis rate,
+            // so that transform bins have the same frequencies.
+            const double ratio = (double) in.sampleRate / fourier.sampleRate;
+            m_resample = false;
+            m_nativeRate = true;
+            m_frameSize = (int) std::floor( fourier.blockSize * ratio + 0.5 );
+            m_frameStep = fourier.stepSize * ratio;
+        }
+        else {
+            std::cout << "*** WARNING: Pipeline: native rate front end requires input rate ("
+                << in.sampleRate << " Hz) above analysis rate (" << fourier.sampleRate << " Hz)."
+                << " Resampling instead." << std::endl;
+            in.frontEnd = InputContext::ResampledFrontEnd;
+        }
+    }
 
     const int mfccFilterCount = 27;
 
     const int chromEntropyLoFreq = 55;
     const int chromEntropyHiFreq = 2000;
 
-    const int statDeltaBlockSize = 5;
-
     const int energyAbsThreshold = -55; // - 55 dB
     const int energyRelThreshold = -10; // 10 dB below average
 
     m_modules.resize( ModuleCount );
 
-    get(ResamplerModule) = new Segmenter::Resampler( in.sampleRate, fourier.sampleRate, inCtx.resampleType );
-    get(EnergyModule) = new Segmenter::Energy( fourier.blockSize );
+    if (m_resample)
+        get(ResamplerModule) = new Segmenter::Resampler( in.sampleRate, fourier.sampleRate, inCtx.resampleType );
+    if (!m_nativeRate)
+        get(EnergyModule) = new Segmenter::Energy( fourier.blockSize, fourier.stepSize );
     get(EnergyGateModule) = new Segmenter::EnergyGate( energyAbsThreshold, energyRelThreshold );
-    get(PowerSpectrumModule) = new Segmenter::PowerSpectrum( fourier.blockSize );
     get(MelSpectrumModule) = new Segmenter::MelSpectrum( mfccFilterCount, fourier.sampleRate,  fourier.blockSize );
-    get(MfccModule) = new Segmenter::Mfcc( mfccFilterCount );
+    // Only MFCC 2 - 4 are used as features
+    std::vector<int> mfccCoefficients;
+    mfccCoefficients.push_back(2);
+    mfccCoefficients.push_back(3);
+    mfccCoefficients.push_back(4);
+    get(MfccModule) = new Segmenter::Mfcc( mfccFilterCount, mfccCoefficients, math.mfcc );
     get(ChromaticEntropyModule) = new Segmenter::ChromaticEntropy( fourier.sampleRate, fourier.blockSize,
-                                                          chromEntropyLoFreq, chromEntropyHiFreq );
-    get(RealCepstrumModule) = new Segmenter::RealCepstrum( fourier.blockSize );
-    get(CepstralFeaturesModule) = new Segmenter::CepstralFeatures( fourier.sampleRate, fourier.blockSize );
-    get(FourHzModulationModule) = new Segmenter::FourHzModulation( fourier.sampleRate, fourier.blockSize, fourier.stepSize );
-    get(StatisticsModule) = new Segmenter::Statistics(stat.blockSize, stat.stepSize, statDeltaBlockSize);
-    get(ClassifierModule) = new Segmenter::Classifier();
+                                                          chromEntropyLoFreq, chromEntropyHiFreq,
+                                                          math.entropy );
+    CepstralFeatures *cepstralFeatures = new Segmenter::CepstralFeatures( fourier.sampleRate, fourier.blockSize );
+    get(CepstralFeaturesModule) = cepstralFeatures;
+    get(RealCepstrumModule) = new Segmenter::RealCepstrum( fourier.blockSize, cepstralFeatures->cepstrumRange(),
+                                                           math.cepstrum );
+    get(FourHzModulationModule) = new Segmenter::FourHzModulation( fourier.sampleRate, mfccFilterCount, fourier.stepSize );
+
+    m_backEnds.resize( statCtxs.size() );
+    for (int idx = 0; idx < (int) m_backEnds.size(); ++idx)
+    {
+        BackEnd & backEnd = m_backEnds[idx];
+        const StatisticContext & stat = backEnd.context = statCtxs[idx];
+
+        backEnd.statisticsModule = new Segmenter::Statistics( stat.blockSize, stat.stepSize,
+                                                              stat.deltaBlockSize, stat.incremental,
+                                                              stat.lookahead );
+        backEnd.classifier = new Segmenter::Classifier( math.classifier );
+        backEnd.stepDuration = Vamp::RealTime::fromSeconds
+            ( (double) stat.stepSize * fourier.stepSize / fourier.sampleRate );
+        // Centred windows start with the first full one, causal ones at the first frame
+        if (stat.lookahead < 0)
+            backEnd.startTime = Vamp::RealTime::fromSeconds
+                ( ((double) stat.blockSize / 2.0) * fourier.stepSize / fourier.sampleRate );
+        backEnd.time = backEnd.startTime;
+
+        if (stat.featureIndex && !m_buildFeatureIndex) {
+            m_featureIndex = FeatureIndex( (double) fourier.sampleRate / fourier.stepSize, stat.deltaBlockSize );
+            m_buildFeatureIndex = true;
+        }
+    }
+
+    // Spectrum bins read by the consumers of magnitude and power spectrum
+
+    MelSpectrum *melSpectrum = static_cast<MelSpectrum*>( get(MelSpectrumModule) );
+    ChromaticEntropy *chromaticEntropy = static_cast<ChromaticEntropy*>( get(ChromaticEntropyModule) );
+    RealCepstrum *realCepstrum = static_cast<RealCepstrum*>( get(RealCepstrumModule) );
+
+    m_magnitudeRange = melSpectrum->inputRange();
+    m_magnitudeRange |= realCepstrum->inputRange();
+    m_magnitudeRange |= cepstralFeatures->inputRange();
+
+    m_powerRange = chromaticEntropy->inputRange();
+
+    BinRange spectrumRange = m_magnitudeRange;
+    spectrumRange |= m_powerRange;
+
+    if (m_nativeRate)
+    {
+        // Only bins below half the analysis rate are used, including energy
+        const int spectrumSize = fourier.blockSize / 2 + 1;
+        spectrumRange |= BinRange(0, spectrumSize);
+
+        PowerSpectrum *powerSpectrum = new Segmenter::PowerSpectrum( m_frameSize, spectrumRange );
+        get(PowerSpectrumModule) = powerSpectrum;
+        get(SpectralEnergyModule) = new Segmenter::SpectralEnergy( *powerSpectrum, spectrumSize );
+    }
+    else
+    {
+        get(PowerSpectrumModule) = new Segmenter::PowerSpectrum( fourier.blockSize, spectrumRange );
+    }
+
+    m_melBandsOffset = m_bandFilterMatrix.append( melSpectrum->filterBank(),
+                                                  - m_magnitudeRange.begin );
+    m_chromaticBandsOffset = m_bandFilterMatrix.append( chromaticEntropy->filterBank(),
+                                                        m_magnitudeRange.size() - m_powerRange.begin );
+
+    m_bandFilterBank.append( melSpectrum->filterBank(), - m_magnitudeRange.begin );
+    while (m_bandFilterBank.filterCount() < m_chromaticBandsOffset)
+        m_bandFilterBank.addFilter( 0, 0, 0 );
+    m_bandFilterBank.append( chromaticEntropy->filterBank(),
+                             m_magnitudeRange.size() - m_powerRange.begin );
 }
 
 Pipeline::~Pipeline()
@@ -86,18 +183,23 @@ Pipeline::~Pipeline()
 
     for (int idx = 0; idx < m_modules.size(); ++idx)
         delete m_modules[idx];
+
+    for (int idx = 0; idx < (int) m_backEnds.size(); ++idx) {
+        delete m_backEnds[idx].statisticsModule;
+        delete m_backEnds[idx].classifier;
+    }
 }
 
 void Pipeline::computeStatistics( const float * input, int inputSize, bool endOfStream )
 {
     Segmenter::Resampler *resampler = static_cast<Segmenter::Resampler*>( get(ResamplerModule) );
     Segmenter::Energy *energy = static_cast<Segmenter::Energy*>( get(EnergyModule) );
+    Segmenter::SpectralEnergy *spectralEnergy = static_cast<Segmenter::SpectralEnergy*>( get(SpectralEnergyModule) );
     Segmenter::EnergyGate *energyGate = static_cast<Segmenter::EnergyGate*>( get(EnergyGateModule) );
     Segmenter::PowerSpectrum *powerSpectrum = static_cast<Segmenter::PowerSpectrum*>( get(PowerSpectrumModule) );
     Segmenter::MelSpectrum *melSpectrum = static_cast<Segmenter::MelSpectrum*>( get(MelSpectrumModule) );
     Segmenter::Mfcc *mfcc = static_cast<Segmenter::Mfcc*>( get(MfccModule) );
     Segmenter::ChromaticEntropy *chromaticEntropy = static_cast<Segmenter::ChromaticEntropy*>( get(ChromaticEntropyModule) );
-    Segmenter::Statistics *statistics = static_cast<Segmenter::Statistics*>( get(StatisticsModule) );
     Segmenter::FourHzModulation *fourHzMod = static_cast<Segmenter::FourHzModulation*>( get(FourHzModulationModule) );
     Segmenter::RealCepstrum *realCepstrum = static_cast<Segmenter::RealCepstrum*>( get(RealCepstrumModule) );
     Segmenter::CepstralFeatures *cepstralFeatures = static_cast<Segmenter::CepstralFeatures*>( get(CepstralFeaturesModule) );
@@ -116,44 +218,94 @@ void Pipeline::computeStatistics( const float * input, int inputSize, bool endOf
     }
 
     m_featBuffer.clear();
-    m_statsBuffer.clear();
+    for (int idx = 0; idx < (int) m_backEnds.size(); ++idx)
+        m_backEnds[idx].statistics.clear();
 
-    int blockFrame;
-    int frameLimit = (int) m_resampBuffer.size() - m_fourierContext.blockSize;
+    int frameCount = 0;
+    while (framePosition(frameCount) + m_frameSize <= (int) m_resampBuffer.size())
+        ++frameCount;
 
-    for ( blockFrame = 0;
-          blockFrame <= frameLimit;
-          blockFrame += m_fourierContext.stepSize )
-    {
-        const float *block = m_resampBuffer.data() + blockFrame;
+    const int spectrumSize = m_fourierContext.blockSize / 2 + 1;
+    const int spectraStride = m_magnitudeRange.size() + m_powerRange.size();
+    const int bandsStride = m_bandFilterMatrix.outputSize();
 
-        energy->process( block );
+    m_frameSpectra.resize( frameCount * spectraStride );
+    m_frameBands.resize( frameCount * bandsStride );
+    m_featBuffer.resize( frameCount );
 
-        energyGate->process( energy->output() );
+    // Time domain and spectrum of all frames
+
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        const float *block = m_resampBuffer.data() + framePosition(frame);
 
         powerSpectrum->process( block );
 
-        const std::vector<float> & powerSpectrumOut = powerSpectrum->output();
-        int nSpectrum = powerSpectrumOut.size();
-        m_spectrumMag.resize( nSpectrum );
-        for (int i = 0; i < nSpectrum; ++i)
-            m_spectrumMag[i] = std::sqrt( powerSpectrumOut[i] );
+        float frameEnergy;
+        if (m_nativeRate) {
+            spectralEnergy->process( powerSpectrum->output().data() );
+            frameEnergy = spectralEnergy->output();
+        }
+        else {
+            energy->process( block );
+            frameEnergy = energy->output();
+        }
+
+        energyGate->process( frameEnergy );
+
+        float *spectra = m_frameSpectra.data() + frame * spectraStride;
+        const float *power = powerSpectrum->output().data();
+        if (m_mathContext.magnitude == MathContext::Fast)
+            kernels().fastSqrt( power + m_magnitudeRange.begin, 0.f, spectra, m_magnitudeRange.size() );
+        else
+            kernels().clampedSqrt( power + m_magnitudeRange.begin, 0.f, spectra, m_magnitudeRange.size() );
+        std::memcpy( spectra + m_magnitudeRange.size(), power + m_powerRange.begin,
+                     m_powerRange.size() * sizeof(float) );
 
-        melSpectrum->process( m_spectrumMag );
+        Statistics::InputFeatures & statInput = m_featBuffer[frame];
+        statInput[Statistics::ENERGY] = frameEnergy;
+        statInput[Statistics::ENERGY_GATE] = energyGate->output();
+    }
+
+    // Mel and chromatic filters for all frames at once
+
+    if (kernels().instructionSet >= Avx2Instructions)
+    {
+        m_bandFilterMatrix.process( m_frameSpectra.data(), spectraStride, frameCount,
+                                    m_frameBands.data(), bandsStride );
+    }
+    else
+    {
+        for (int frame = 0; frame < frameCount; ++frame)
+            m_bandFilterBank.process( m_frameSpectra.data() + frame * spectraStride,
+                                      m_frameBands.data() + frame * bandsStride );
+    }
+
+    // Remaining features of each frame
+
+    m_spectrumMag.resize( spectrumSize, 0.f );
+
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        const float *spectra = m_frameSpectra.data() + frame * spectraStride;
+        const float *bands = m_frameBands.data() + frame * bandsStride;
+
+        melSpectrum->processFiltered( bands + m_melBandsOffset );
 
         mfcc->process( melSpectrum->output() );
 
-        chromaticEntropy->process( powerSpectrum->output() );
+        chromaticEntropy->processFiltered( bands + m_chromaticBandsOffset );
 
         fourHzMod->process( melSpectrum->output() );
 
+        std::memcpy( m_spectrumMag.data() + m_magnitudeRange.begin, spectra,
+                     m_magnitudeRange.size() * sizeof(float) );
+
         realCepstrum->process( m_spectrumMag );
 
         cepstralFeatures->process( m_spectrumMag, realCepstrum->output() );
 
-        Statistics::InputFeatures statInput;
-        statInput[Statistics::ENERGY] = energy->output();
-        statInput[Statistics::ENERGY_GATE] = energyGate->output();
+        Statistics::InputFeatures & statInput = m_featBuffer[frame];
         statInput[Statistics::ENTROPY]  = chromaticEntropy->output();
         statInput[Statistics::MFCC2] = mfcc->output()[2];
         statInput[Statistics::MFCC3] = mfcc->output()[3];
@@ -163,52 +315,96 @@ void Pipeline::computeStatistics( const float * input, int inputSize, bool endOf
         statInput[Statistics::TONALITY1] = cepstralFeatures->tonality1();
         statInput[Statistics::FOUR_HZ_MOD] = fourHzMod->output();
 
-        m_featBuffer.push_back( statInput );
+        for (int idx = 0; idx < (int) m_backEnds.size(); ++idx)
+            m_backEnds[idx].statisticsModule->process( statInput, m_backEnds[idx].statistics );
+    }
 
-        statistics->process( statInput, m_statsBuffer );
+    if (endOfStream) {
+        for (int idx = 0; idx < (int) m_backEnds.size(); ++idx)
+            m_backEnds[idx].statisticsModule->processRemainingData( m_backEnds[idx].statistics );
     }
 
-    if (endOfStream)
-        statistics->processRemainingData( m_statsBuffer );
+    if (m_buildFeatureIndex) {
+        m_featureIndex.append( m_featBuffer.data(), m_featBuffer.size() );
+        if (endOfStream)
+            m_featureIndex.finish();
+    }
+
+    const double nextFrame = m_framePosition + frameCount * m_frameStep;
+    const int consumed = std::min( (int) std::floor(nextFrame), (int) m_resampBuffer.size() );
+    m_framePosition = nextFrame - consumed;
 
-    m_resampBuffer.erase( m_resampBuffer.begin(), m_resampBuffer.begin() + blockFrame );
+    m_resampBuffer.erase( m_resampBuffer.begin(),
+                          m_resampBuffer.begin() + consumed );
 }
 
-void Pipeline::computeClassification( Vamp::Plugin::FeatureList & output_list )
+Vamp::RealTime Pipeline::statisticsTime( int output, int statIndex ) const
 {
-    Segmenter::Classifier *classifier = static_cast<Segmenter::Classifier*>( get(ClassifierModule) );
+    const BackEnd & backEnd = m_backEnds[statIndex];
+    const double step = (double) backEnd.context.stepSize * m_fourierContext.stepSize / m_fourierContext.sampleRate;
+    return backEnd.startTime + Vamp::RealTime::fromSeconds( output * step );
+}
 
-    for (int i = 0; i < m_statsBuffer.size(); ++i)
-    {
-        const Statistics::OutputFeatures & stat = m_statsBuffer[i];
+bool Pipeline::setClassifierModel( const std::shared_ptr<const ClassifierModel> & model, int statIndex )
+{
+    // classifier inputs are the statistics before the energy gate
+    if (!model || model->inputCount() != Statistics::ENERGY_GATE_MEAN) {
+        std::cout << "*** WARNING: Pipeline: classifier model does not take the statistics as input." << std::endl;
+        return false;
+    }
+
+    for (int idx = 0; idx < (int) m_backEnds.size(); ++idx)
+        if (statIndex < 0 || idx == statIndex)
+            m_backEnds[idx].classifier->setModel( model );
+
+    return true;
+}
+
+int Pipeline::framePosition( int frame ) const
+{
+    return (int) std::floor( m_framePosition + frame * m_frameStep + 0.5 );
+}
 
-        float classification = m_last_classification;
+void Pipeline::computeClassification( Vamp::Plugin::FeatureList & output_list, int statIndex )
+{
+    BackEnd & backEnd = m_backEnds[statIndex];
+    Segmenter::Classifier *classifier = backEnd.classifier;
+
+    const int count = backEnd.statistics.size();
+    if (!count)
+        return;
 
-        if (stat[Statistics::ENERGY_GATE_MEAN] > 0.4)
-        {
-            classifier->process( stat.data );
+    // classify the whole block, and keep the results of gated windows only
+    classifier->process( backEnd.statistics[0].data,
+                         Statistics::OUTPUT_FEATURE_COUNT, count );
 
-            const std::vector<float> & distribution = classifier->probabilities();
+    const std::vector<float> & distribution = classifier->probabilities();
+    const int classCount = classifier->classCount();
 
-            static int class_mapping[5] = { 1, 2, 3, 4, 0 };
+    for (int i = 0; i < count; ++i)
+    {
+        const Statistics::OutputFeatures & stat = backEnd.statistics[i];
+        const float * probabilities = &distribution[i * classCount];
 
-            classification = 0;
-            for (int i = 0; i < distribution.size(); ++i)
-                classification += distribution[i] * class_mapping[i];
-            classification /= distribution.size() - 1;
+        // classes map to 1, 2, ... except the last one, which maps to 0
+        float value = 0;
+        for (int c = 0; c < classCount - 1; ++c)
+            value += probabilities[c] * (c + 1);
+        value /= classCount - 1;
 
-            m_last_classification = classification;
-        }
+        const bool gated = stat[Statistics::ENERGY_GATE_MEAN] > 0.4;
+        const float classification = gated ? value : backEnd.lastClassification;
+        backEnd.lastClassification = classification;
 
         Vamp::Plugin::Feature output;
         output.hasTimestamp = true;
-        output.timestamp = m_statsTime;
+        output.timestamp = backEnd.time;
         output.values.push_back( classification );
         //output.values = distribution;
 
         output_list.push_back( output );
 
-        m_statsTime = m_statsTime + m_statsStepDuration;
+        backEnd.time = backEnd.time + backEnd.stepDuration;
     }
 }
 
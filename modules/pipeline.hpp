@@ -23,6 +23,9 @@
 
 #include "module.hpp"
 #include "statistics.hpp"
+#include "feature_index.hpp"
+#include "classifier_model.hpp"
+#include "filter_bank.hpp"
 
 #include <vector>
 
@@ -33,11 +36,23 @@
 
 namespace Segmenter {
 
+class Classifier;
+
 struct InputContext {
-    InputContext(): sampleRate(1), blockSize(0), resampleType(SRC_SINC_FASTEST) {}
+    enum FrontEnd {
+        // Resample input to the analysis rate of FourierContext
+        ResampledFrontEnd,
+        // Analyse input at its own rate, with a proportionally larger transform,
+        // and use the spectrum bins below half the analysis rate
+        NativeRateFrontEnd
+    };
+
+    InputContext(): sampleRate(1), blockSize(0), resampleType(SRC_SINC_FASTEST),
+        frontEnd(ResampledFrontEnd) {}
     float sampleRate;
     int resampleType;
     int blockSize;
+    FrontEnd frontEnd;
 };
 
 class Pipeline
@@ -45,24 +60,57 @@ class Pipeline
 public:
     Pipeline ( const InputContext & inCtx,
                const FourierContext & fCtx = FourierContext(),
-               const StatisticContext & statCtx = StatisticContext());
+               const StatisticContext & statCtx = StatisticContext(),
+               const MathContext & mathCtx = MathContext() );
+
+    // One front end, feeding the same features to the statistics and
+    // classification of each of 'statCtxs', e.g. for a parameter sweep.
+    // Statistics and classification of each are selected by its index.
+    Pipeline ( const InputContext & inCtx,
+               const FourierContext & fCtx,
+               const std::vector<StatisticContext> & statCtxs,
+               const MathContext & mathCtx = MathContext() );
 
     ~Pipeline();
 
     const InputContext & inputContext() const { return m_inputContext; }
     const FourierContext & fourierContext() const { return m_fourierContext; }
-    const StatisticContext & statisticContext() const { return m_statContext; }
+    int statisticContextCount() const { return m_backEnds.size(); }
+    const StatisticContext & statisticContext( int index = 0 ) const { return m_backEnds[index].context; }
+    const MathContext & mathContext() const { return m_mathContext; }
+
+    // Size of the transform applied to input frames;
+    // differs from the FourierContext with NativeRateFrontEnd.
+    int transformSize() const { return m_frameSize; }
 
     void computeStatistics( const float * input, int count, bool last = false );
-    void computeClassification( Vamp::Plugin::FeatureList & output );
+    void computeClassification( Vamp::Plugin::FeatureList & output, int statIndex = 0 );
+
+    // Classifies with the given model from the next call to computeClassification() on,
+    // for the given statistic context or all of them if negative.
+    // May be called from another thread than the one computing the classification.
+    // Returns false and keeps the current model if the model does not take
+    // the statistics as input.
+    bool setClassifierModel( const std::shared_ptr<const ClassifierModel> & model, int statIndex = -1 );
 
     const std::vector<Statistics::InputFeatures> & features() const { return m_featBuffer; }
-    const std::vector<Statistics::OutputFeatures> & statistics() const { return m_statsBuffer; }
+    const std::vector<Statistics::OutputFeatures> & statistics( int statIndex = 0 ) const
+    { return m_backEnds[statIndex].statistics; }
+
+    // Time of the statistics and classification output of the given number,
+    // counting from the first output since the start
+    Vamp::RealTime statisticsTime( int output, int statIndex = 0 ) const;
+
+    // Index of the features of all frames so far, if enabled by StatisticContext::featureIndex
+    // (of any of the contexts, with the delta length of the first such);
+    // complete after the last call to computeStatistics().
+    const FeatureIndex & featureIndex() const { return m_featureIndex; }
 
 private:
     enum ModuleType {
         ResamplerModule = 0,
         EnergyModule,
+        SpectralEnergyModule,
         EnergyGateModule,
         PowerSpectrumModule,
         MelSpectrumModule,
@@ -71,31 +119,66 @@ private:
         RealCepstrumModule,
         CepstralFeaturesModule,
         FourHzModulationModule,
-        StatisticsModule,
-        ClassifierModule,
 
         ModuleCount
     };
 
+    // Statistics and classification of one StatisticContext
+    struct BackEnd {
+        BackEnd(): statisticsModule(0), classifier(0), lastClassification(0.f) {}
+        StatisticContext context;
+        Statistics *statisticsModule;
+        Classifier *classifier;
+        std::vector<Statistics::OutputFeatures> statistics;
+        float lastClassification;
+        Vamp::RealTime stepDuration;
+        Vamp::RealTime startTime;
+        Vamp::RealTime time;
+    };
+
     Module *& get( ModuleType type ) { return m_modules[type]; }
 
+    // Start of a frame in the input buffer, counting from the next frame
+    int framePosition( int frame ) const;
+
 private:
     InputContext m_inputContext;
     FourierContext m_fourierContext;
-    StatisticContext m_statContext;
-
-    Vamp::RealTime m_statsStepDuration;
-    Vamp::RealTime m_statsTime;
+    MathContext m_mathContext;
 
     std::vector<Module*> m_modules;
+    std::vector<BackEnd> m_backEnds;
 
     std::vector<float> m_resampBuffer;
     std::vector<float> m_spectrumMag;
+
+    // Bins of magnitude and power spectrum read by any module;
+    // only these are computed and stored for each frame.
+    BinRange m_magnitudeRange;
+    BinRange m_powerRange;
+
+    // Mel and chromatic filters stacked over [ magnitude spectrum, power spectrum ],
+    // applied to all frames available in a call at once: as a matrix product
+    // with AVX2 and up, else frame by frame with the sparse bank.
+    // Both write the bands at the same offsets.
+    FilterMatrix m_bandFilterMatrix;
+    SparseFilterBank m_bandFilterBank;
+    int m_melBandsOffset;
+    int m_chromaticBandsOffset;
+    std::vector<float> m_frameSpectra;
+    std::vector<float> m_frameBands;
     std::vector<Statistics::InputFeatures> m_featBuffer;
-    std::vector<Segmenter::Statistics::OutputFeatures> m_statsBuffer;
-    float m_last_classification;
+    FeatureIndex m_featureIndex;
+    bool m_buildFeatureIndex;
 
     bool m_resample;
+    bool m_nativeRate;
+
+    // Size and hop of frames in input buffer samples,
+    // and position of the next frame (fractional when resampling by the transform)
+    int m_frameSize;
+    double m_frameStep;
+    double m_framePosition;
 };
 
 } // namespace Segmenter
@@ -22,51 +22,98 @@
 #define SEGMENTER_REAL_CEPSTRUM_INCLUDED
 
 #include "module.hpp"
+#include "kernels.hpp"
+#include "tables.hpp"
 
 #include <vector>
 #include <cmath>
-#include <fftw3.h>
+#include "fft.hpp"
 #include <cassert>
+#include <algorithm>
+#include <chrono>
 
 namespace Segmenter {
 
+/*
+    Real cepstrum of a magnitude spectrum, using the square root
+    instead of the logarithm.
+
+    If only a range of cepstrum indices is needed, they are computed either
+    by the full DCT, or as dot products with precomputed cosine rows,
+    whichever process() takes less time to run at construction.
+    Indices outside the range are then left at zero.
+*/
 class RealCepstrum : public Module
 {
-    fftwf_plan m_plan;
+    RealTransform *m_transform;
+    std::vector<float> m_rowsInput;
     float *m_fft_in;
-    float *m_fft_out;
 
     int m_bufSize;
 
+    BinRange m_outputRange;
+    Tables::FloatTable m_cosineRows;
+
     std::vector<float> m_output;
-    float m_outputScale;
+
+    MathContext::Precision m_precision;
 
 public:
 
-    RealCepstrum( int windowSize )
+    RealCepstrum( int windowSize, BinRange outputRange = BinRange(),
+                  MathContext::Precision precision = MathContext::Accurate ):
+        m_precision(precision)
     {
         assert( windowSize >= 2 );
 
         m_bufSize = (windowSize / 2) + 1;
 
-        m_fft_in = fftwf_alloc_real(m_bufSize);
-        m_fft_out = fftwf_alloc_real(m_bufSize);
-        m_plan = fftwf_plan_r2r_1d(m_bufSize, m_fft_in, m_fft_out,
-                                   FFTW_REDFT10, FFTW_ESTIMATE);
-
-        for (int i = 0; i < m_bufSize; ++i)
-            m_fft_in[i] = 0.f;
-
-        m_output.resize(m_bufSize);
-
-        m_outputScale = 1.f / std::sqrt( 2.0f * m_bufSize );
+        m_outputRange = outputRange;
+        if (m_outputRange.empty())
+            m_outputRange = BinRange(0, m_bufSize);
+        m_outputRange.begin = std::max( m_outputRange.begin, 0 );
+        m_outputRange.end = std::min( m_outputRange.end, m_bufSize );
+
+        m_transform = createTransform( RealTransform::Dct2, m_bufSize );
+        m_fft_in = m_transform->input();
+
+        m_output.resize(m_bufSize, 0.f);
+
+        if (m_outputRange.size() < m_bufSize)
+        {
+            // Rows of FFTW's REDFT10, with the scaling of process() applied
+            std::vector<int> rows;
+            for (int k = m_outputRange.begin; k < m_outputRange.end; ++k)
+                rows.push_back(k);
+            m_cosineRows = Tables::cosineRows( m_bufSize, rows, 1.0 );
+            m_rowsInput.resize( m_bufSize, 0.f );
+
+            RealTransform *transform = m_transform;
+            const double transformTime = processTime();
+
+            m_transform = 0;
+            m_fft_in = m_rowsInput.data();
+            const double rowsTime = processTime();
+
+            if (rowsTime < transformTime)
+            {
+                delete transform;
+            }
+            else
+            {
+                m_transform = transform;
+                m_fft_in = transform->input();
+                m_cosineRows.reset();
+                m_rowsInput.clear();
+            }
+
+            std::fill( m_output.begin(), m_output.end(), 0.f );
+        }
     }
 
     ~RealCepstrum()
     {
-        fftwf_free(m_fft_in);
-        fftwf_free(m_fft_out);
-        fftwf_destroy_plan(m_plan);
+        delete m_transform;
     }
 
     void process ( const std::vector<float> & spectrumMagnitude )
@@ -75,23 +122,57 @@ public:
 
         int nSpectrum = spectrumMagnitude.size();
 
-        for (int i = 0; i < nSpectrum; ++i ) {
-            float val = std::max( spectrumMagnitude[i], ath );
-            // NOTE: Officially, the following should be log instead of sqrt.
-            // sqrt reportedly proved better at classification.
-            val = std::sqrt(val);
-            m_fft_in[i] = val;
+        // NOTE: Officially, the following should be log instead of sqrt.
+        // sqrt reportedly proved better at classification.
+        if (m_precision == MathContext::Fast)
+            kernels().fastSqrt( spectrumMagnitude.data(), ath, m_fft_in, nSpectrum );
+        else
+            kernels().clampedSqrt( spectrumMagnitude.data(), ath, m_fft_in, nSpectrum );
+
+        if (m_transform)
+        {
+            m_transform->execute();
+
+            const float *fft_out = m_transform->output();
+            kernels().scale( 0.5f, fft_out + m_outputRange.begin,
+                             m_output.data() + m_outputRange.begin, m_outputRange.size() );
+            if (m_outputRange.begin == 0)
+                m_output[0] = fft_out[0] / sqrt(2.0f) * 0.5f;
+        }
+        else
+        {
+            const Kernels & k = kernels();
+            const float *row = m_cosineRows->data();
+            for (int idx = m_outputRange.begin; idx < m_outputRange.end; ++idx, row += m_bufSize)
+                m_output[idx] = k.dot( row, m_fft_in, m_bufSize );
         }
-
-        fftwf_execute( m_plan );
-
-        m_fft_out[0] /= sqrt(2.0f);
-        for (int i = 0; i < nSpectrum; ++i)
-            //m_output[i] = m_fft_out[i] * m_outputScale * 0.5f;
-            m_output[i] = m_fft_out[i] * 0.5f;
     }
 
     const std::vector<float> & output() const { return m_output; }
+
+    // Indices of output() that are computed
+    BinRange outputRange() const { return m_outputRange; }
+
+    // Spectrum bins read by process()
+    BinRange inputRange() const { return BinRange(0, m_bufSize); }
+
+private:
+
+    // Shortest time of a few short runs of process(), in seconds
+    double processTime()
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        const std::vector<float> spectrum( m_bufSize, 1.f );
+        double time = HUGE_VAL;
+        for (int run = 0; run < 5; ++run) {
+            Clock::time_point start = Clock::now();
+            for (int repeat = 0; repeat < 4; ++repeat)
+                process( spectrum );
+            time = std::min( time, std::chrono::duration<double>( Clock::now() - start ).count() );
+        }
+        return time;
+    }
 };
 
 } // namespace Segmenter
@@ -22,101 +22,210 @@
 #define SEGMENTER_FFT_HPP_INCLUDED
 
 #include "module.hpp"
+#include "kernels.hpp"
+#include "tables.hpp"
+#include "fft.hpp"
 
 #include <vector>
 #include <cmath>
 #include <cstring>
-#include <fftw3.h>
+#include <algorithm>
 
 #define POWER_SPECTRUM_SCALING 1
 
 namespace Segmenter {
 
+/*
+    Power spectrum of a Hamming-windowed block.
+
+    When only a range of output bins is needed, the transform can be pruned:
+    the block is split into L interleaved subsequences of length N / L,
+    each transformed separately, and only the requested bins of the full
+    transform are combined from them:
+
+        X[k] = sum_r W_N^(r k) Y_r[k mod N/L]
+
+    This skips the last log2(L) stages of the transform at the cost of
+    L complex multiply-adds per output bin, and is chosen only when the
+    estimated operation count is lower than that of the full transform.
+    Bins outside the requested range are then left at zero.
+    The subsequences are transformed one after another by a single
+    transform of size N / L from the FFT backend.
+*/
 class PowerSpectrum : public Module
 {
     int m_windowSize;
-    fftwf_plan m_plan;
-    float *m_inBuffer;
-    float *m_outBuffer;
-    float *m_window;
+    RealTransform *m_transform;
+    Tables::FloatTable m_window;
     std::vector<float> m_output;
     float m_outputScale;
 
+    BinRange m_outputRange;
+    int m_decimation;
+    int m_subSize;
+    std::vector<float> m_block;
+    std::vector<float> m_subSpectra;
+    Tables::FloatTable m_twiddles;
+
 public:
-    PowerSpectrum( int windowSize ):
-        m_windowSize(windowSize)
+    PowerSpectrum( int windowSize, BinRange outputRange = BinRange() ):
+        m_windowSize(windowSize),
+        m_transform(0)
     {
-        m_inBuffer = fftwf_alloc_real(windowSize);
-        m_outBuffer = fftwf_alloc_real(windowSize);
-        m_plan = fftwf_plan_r2r_1d(windowSize, m_inBuffer, m_outBuffer,
-                                   FFTW_R2HC, FFTW_ESTIMATE);
+        const int spectrumSize = windowSize / 2 + 1;
 
-        double pi = Segmenter::pi();
+        m_outputRange = outputRange;
+        if (m_outputRange.empty())
+            m_outputRange = BinRange(0, spectrumSize);
+        m_outputRange.begin = std::max( m_outputRange.begin, 0 );
+        m_outputRange.end = std::min( m_outputRange.end, spectrumSize );
 
-        m_window = new float[windowSize];
+        m_decimation = prunedDecimation( windowSize, m_outputRange.size() );
+        m_subSize = windowSize / m_decimation;
 
-        float sumWindow = 0.f;
-        for (int idx=0; idx < windowSize; ++idx) {
-            // hamming window:
-            m_window[idx] = 0.54 - 0.46 * std::cos(2 * pi * idx / (windowSize-1) );
-            sumWindow += m_window[idx];
+        m_transform = createTransform( RealTransform::RealToHalfComplex, m_subSize );
+
+        if (m_decimation > 1)
+        {
+            m_block.resize( windowSize );
+            m_subSpectra.resize( windowSize );
+            m_twiddles = Tables::prunedTwiddles( windowSize, m_outputRange, m_decimation );
         }
 
+        m_window = Tables::hammingWindow( windowSize );
+
+        float sumWindow = 0.f;
+        for (int idx=0; idx < windowSize; ++idx)
+            sumWindow += (*m_window)[idx];
+
         m_outputScale = 2.f / sumWindow;
         m_outputScale *= m_outputScale; // square, because we'll be multiplying power instead of raw spectrum
 
-        m_output.resize(windowSize / 2 + 1);
+        m_output.resize(spectrumSize, 0.f);
     }
 
     ~PowerSpectrum()
     {
-        fftwf_free(m_inBuffer);
-        fftwf_free(m_outBuffer);
-        fftwf_destroy_plan(m_plan);
+        delete m_transform;
     }
 
     void process ( const float *input )
     {
-        for (int idx = 0; idx < m_windowSize; ++idx)
-            m_inBuffer[idx] = input[idx] * m_window[idx];
+#if POWER_SPECTRUM_SCALING
+        const float scale = m_outputScale;
+#else
+        const float scale = 1.f;
+#endif
+        if (m_decimation > 1)
+        {
+            kernels().multiply( input, m_window->data(), m_block.data(), m_windowSize );
+            transformPruned();
+            combinePruned( scale );
+        }
+        else
+        {
+            kernels().multiply( input, m_window->data(), m_transform->input(), m_windowSize );
+            m_transform->execute();
+            kernels().halfComplexPower( m_transform->output(), m_windowSize, scale, m_output.data() );
+        }
+    }
 
-        fftwf_execute( m_plan );
+    const std::vector<float> & output() const { return m_output; }
 
-        float * out = m_output.data();
-        float * fft = m_outBuffer;
-        const int winSize = m_windowSize;
+    // Bins of output() that are computed
+    BinRange outputRange() const { return m_outputRange; }
 
-        float r, i; // real and imaginary parts
+    int windowSize() const { return m_windowSize; }
+    const float * window() const { return m_window->data(); }
 
-        r = fft[0];
-        out[0] = r * r;
+    // Factor applied to squared magnitudes of the transform
+    float outputScale() const
+    {
 #if POWER_SPECTRUM_SCALING
-        out[0] *= m_outputScale;
+        return m_outputScale;
+#else
+        return 1.f;
 #endif
+    }
 
-        const int pairCount = (winSize + 1) / 2;
-        for (int idx = 1; idx < pairCount; ++idx)
+    bool isPruned() const { return m_decimation > 1; }
+
+    // Number of interleaved subsequences for a pruned transform
+    // of 'binCount' bins, or 1 if the full transform is cheaper.
+    static int prunedDecimation( int windowSize, int binCount )
+    {
+        // Rough operation counts: 2.5 N log2(N) for a real transform,
+        // N to gather the subsequences, and 8 flops per complex multiply-add.
+        const double fullCost = 2.5 * windowSize * std::log((double) windowSize) / std::log(2.0);
+
+        int bestDecimation = 1;
+        double bestCost = fullCost;
+        for (int decimation = 2; windowSize % decimation == 0 && windowSize / decimation >= 8;
+             decimation *= 2)
         {
-            r = fft[idx];
-            i = fft[winSize - idx];
-            out[idx] = r * r + i * i;
-#if POWER_SPECTRUM_SCALING
-            out[idx] *= m_outputScale;
-#endif
+            const int subSize = windowSize / decimation;
+            double cost = 2.5 * windowSize * std::log((double) subSize) / std::log(2.0)
+                + windowSize + 8.0 * binCount * decimation;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestDecimation = decimation;
+            }
         }
+        return bestDecimation;
+    }
 
-        if (winSize % 2 == 0)
+private:
+    // Half-complex spectra of the subsequences x[r + L n], one after another
+    void transformPruned()
+    {
+        float *subInput = m_transform->input();
+        for (int r = 0; r < m_decimation; ++r)
         {
-            const int lastIdx = winSize / 2;
-            r = fft[lastIdx];
-            out[lastIdx] = r * r;
-#if POWER_SPECTRUM_SCALING
-            out[lastIdx] *= m_outputScale;
-#endif
+            const float *x = m_block.data() + r;
+            for (int n = 0; n < m_subSize; ++n, x += m_decimation)
+                subInput[n] = *x;
+
+            m_transform->execute();
+
+            std::memcpy( m_subSpectra.data() + r * m_subSize, m_transform->output(),
+                         sizeof(float) * m_subSize );
         }
     }
 
-    const std::vector<float> & output() const { return m_output; }
+    void combinePruned( float scale )
+    {
+        const float *twiddle = m_twiddles->data();
+
+        for (int bin = m_outputRange.begin; bin < m_outputRange.end; ++bin)
+        {
+            // Y_r[M - k] = conj( Y_r[k] ) for real subsequences
+            int subBin = bin % m_subSize;
+            int reIndex = subBin;
+            int imIndex = m_subSize - subBin;
+            float sign = 1.f;
+            if (2 * subBin > m_subSize) {
+                std::swap( reIndex, imIndex );
+                sign = -1.f;
+            }
+            // Y_r[0] and Y_r[M/2] are real
+            if (subBin == 0 || 2 * subBin == m_subSize) {
+                imIndex = reIndex;
+                sign = 0.f;
+            }
+
+            float re = 0.f;
+            float im = 0.f;
+            const float *y = m_subSpectra.data();
+            for (int r = 0; r < m_decimation; ++r, y += m_subSize, twiddle += 2) {
+                float yRe = y[reIndex];
+                float yIm = sign * y[imIndex];
+                re += twiddle[0] * yRe - twiddle[1] * yIm;
+                im += twiddle[0] * yIm + twiddle[1] * yRe;
+            }
+
+            m_output[bin] = (re * re + im * im) * scale;
+        }
+    }
 };
 
 } // namespace Segmenter
@@ -22,9 +22,13 @@
 #define SEGMENTER_STATISTICS_HPP_INCLUDED
 
 #include "module.hpp"
+#include "kernels.hpp"
+#include "delta_filter.hpp"
 
 #include <vector>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 namespace Segmenter {
 
@@ -91,49 +95,151 @@ private:
         DELTA_FEATURE_COUNT
     };
 
-    struct DeltaFeatures {
-        float data [DELTA_FEATURE_COUNT];
-        float & operator [] (DeltaFeature i) { return data[i]; }
-        const float & operator [] (DeltaFeature i) const { return data[i]; }
-    };
-
+    /*
+        Fixed capacity FIFO of floats. Each value is stored twice, 'capacity'
+        apart, so any run of stored values is contiguous in memory
+        and can be read in place without unwrapping.
+    */
+    class History {
+        std::vector<float> m_data;
+        int m_capacity;
+        int m_begin;
+        int m_size;
+
+    public:
+        History(): m_capacity(0), m_begin(0), m_size(0) {}
+
+        void reset( int capacity )
+        {
+            m_data.assign( 2 * capacity, 0.f );
+            m_capacity = capacity;
+            m_begin = m_size = 0;
+        }
 
-    struct Vector {
-        float *data;
-        int observations;
-        int samples;
+        int size() const { return m_size; }
+        const float * data( int index ) const { return &m_data[m_begin + index]; }
+        float operator [] ( int index ) const { return m_data[m_begin + index]; }
+        float back() const { return (*this)[m_size - 1]; }
 
-        Vector( std::vector<InputFeatures> & feature_vector, int index, int count, InputFeature feature ):
-            data( &feature_vector[index][feature] ),
-            observations( INPUT_FEATURE_COUNT ),
-            samples( count )
-        {};
+        void push_back( float value )
+        {
+            assert( m_size < m_capacity );
+            int position = m_begin + m_size;
+            if (position >= m_capacity)
+                position -= m_capacity;
+            m_data[position] = m_data[position + m_capacity] = value;
+            ++m_size;
+        }
 
-        Vector( std::vector<DeltaFeatures> & feature_vector, int index, int count, DeltaFeature feature ):
-            data( &feature_vector[index][feature] ),
-            observations( DELTA_FEATURE_COUNT ),
-            samples( count )
-        {};
+        void pop_front( int count )
+        {
+            assert( count <= m_size );
+            m_begin += count;
+            if (m_begin >= m_capacity)
+                m_begin -= m_capacity;
+            m_size -= count;
+        }
     };
 
     int m_windowSize;
     int m_stepSize;
 
-    std::vector<float> m_deltaFilter;
+    DeltaFilter m_deltaFilter;
     int m_halfFilterLen;
 
-    std::vector<InputFeatures> m_inputBuffer;
-    std::vector<DeltaFeatures> m_deltaBuffer;
+    /*
+        With a lookahead of L >= 0 frames (causal mode), the statistics of
+        frame t are taken over the window of frames ending at t + L, cut off
+        at the first frame; deltas of a frame are the slope of the regression
+        over the frames ending at it. Otherwise (L < 0), windows are centred
+        and deltas are taken over the frames around it.
+        A delta row is paired with the input row m_inputOffset after it.
+    */
+    int m_lookahead;
+    int m_inputOffset;
+    // Delta rows dropped from the buffers so far, and the end of the next window,
+    // counting from the first delta row
+    int m_rowsDropped;
+    int m_nextWindowEnd;
+    bool m_flushing;
+
+    // Feature history, one contiguous column per feature, and
+    // the energy gate as a mask of 1 for gated frames and 0 otherwise
+    History m_inputBuffer[INPUT_FEATURE_COUNT];
+    History m_deltaBuffer[DELTA_FEATURE_COUNT];
+    History m_gateMask;
+    // new deltas, before they enter the delta history
+    std::vector<float> m_deltaBlock;
+
+    // Input features followed by delta features
+    static const int COLUMN_COUNT = INPUT_FEATURE_COUNT + DELTA_FEATURE_COUNT;
+
+    // Columns that statistics are taken of: all from ENTROPY on
+    static const int MOMENT_COLUMN_COUNT = COLUMN_COUNT - ENTROPY;
+
+    /*
+        Gated count, sums and sums of squares of all columns
+        over window rows [m_runningBegin, m_runningEnd), for incremental mode.
+        Sums are of differences to a shift near the mean, in double precision,
+        and are summed anew from the rows once as many rows have entered
+        as the window holds, so rounding errors do not accumulate.
+    */
+
+    struct RunningSums {
+        double count;
+        double sum[COLUMN_COUNT];
+        double sumOfSquares[COLUMN_COUNT];
+        double shift[COLUMN_COUNT];
+    };
+
+    bool m_incremental;
+    RunningSums m_running;
+    bool m_runningValid;
+    int m_runningBegin;
+    int m_runningEnd;
+    int m_rowsSinceAnchor;
 
     bool m_first;
 
 public:
-    Statistics( int windowSize, int stepSize, int deltaWindowSize ):
+    Statistics( int windowSize, int stepSize, int deltaWindowSize, bool incremental = false,
+                int lookahead = -1 ):
         m_windowSize(windowSize),
         m_stepSize(stepSize),
-        m_first(false)
+        m_lookahead(lookahead),
+        m_rowsDropped(0),
+        m_flushing(false),
+        m_incremental(incremental),
+        m_runningValid(false),
+        m_runningBegin(0),
+        m_runningEnd(0),
+        m_rowsSinceAnchor(0),
+        m_first(lookahead >= 0)
     {
         initDeltaFilter( deltaWindowSize );
+
+        if (m_lookahead >= 0) {
+            // beyond half a window, statistics would no longer include their frame
+            m_lookahead = std::min( m_lookahead, m_windowSize / 2 );
+            m_inputOffset = 2 * m_halfFilterLen;
+            m_nextWindowEnd = m_lookahead + 1;
+        }
+        else {
+            m_inputOffset = m_halfFilterLen;
+            m_nextWindowEnd = m_windowSize;
+        }
+
+        // Deltas are kept until a window is complete, and the inputs they
+        // are computed from; padding adds up to a filter at each end.
+        const int filterSize = m_deltaFilter.length();
+        const int deltaCapacity = m_windowSize + std::max( m_stepSize, filterSize );
+        const int inputCapacity = deltaCapacity + 2 * filterSize;
+        for (int f = 0; f < INPUT_FEATURE_COUNT; ++f)
+            m_inputBuffer[f].reset( inputCapacity );
+        for (int f = 0; f < DELTA_FEATURE_COUNT; ++f)
+            m_deltaBuffer[f].reset( deltaCapacity );
+        m_gateMask.reset( inputCapacity );
+        m_deltaBlock.resize( DELTA_FEATURE_COUNT * inputCapacity );
     }
 
     void process ( const InputFeatures & input, std::vector<OutputFeatures> & outBuffer )
@@ -142,193 +248,321 @@ public:
         // pad beginning and end for the purpose of delta computations
         if (m_first) {
             m_first = false;
-            m_inputBuffer.insert( m_inputBuffer.begin(), m_halfFilterLen, input );
+            append( m_inputOffset, input );
         }
 
-        m_inputBuffer.push_back(input);
+        append( 1, input );
 
         process( outBuffer );
     }
 
     void processRemainingData ( std::vector<OutputFeatures> & outBuffer )
     {
-        if ( !m_inputBuffer.size() )
+        if ( !inputCount() )
             return;
 
-        InputFeatures lastInput = m_inputBuffer.back();
+        if (m_lookahead >= 0) {
+            // All frames have deltas; windows of the last frames end early
+            m_flushing = true;
+            process( outBuffer );
+            return;
+        }
 
-        m_inputBuffer.insert( m_inputBuffer.end(), m_halfFilterLen, lastInput );
+        InputFeatures lastInput;
+        for (int f = 0; f < INPUT_FEATURE_COUNT; ++f)
+            lastInput.data[f] = m_inputBuffer[f].back();
+
+        append( m_halfFilterLen, lastInput );
 
         process( outBuffer );
     }
 
 private:
+    int inputCount() const { return m_gateMask.size(); }
+    int deltaCount() const { return m_deltaBuffer[0].size(); }
+
+    void append( int count, const InputFeatures & input )
+    {
+        for (int i = 0; i < count; ++i) {
+            for (int f = 0; f < INPUT_FEATURE_COUNT; ++f)
+                m_inputBuffer[f].push_back( input.data[f] );
+            m_gateMask.push_back( input[ENERGY_GATE] == 1.f ? 1.f : 0.f );
+        }
+    }
+
     void process ( std::vector<OutputFeatures> & outBuffer )
     {
-        if (m_inputBuffer.size() < m_deltaFilter.size())
+        if (inputCount() < m_deltaFilter.length())
             return;
 
-        const int inputBufSize = m_inputBuffer.size();
-        const int deltaFilterSize = m_deltaFilter.size();
+        const int inputBufSize = inputCount();
+        const int deltaFilterSize = m_deltaFilter.length();
 
         // compute deltas for new inputs and populate delta buffer
+        const int firstInputToProcess = deltaCount();
         const int lastInputToProcess = inputBufSize - deltaFilterSize;
-        for (int idx = m_deltaBuffer.size(); idx <= lastInputToProcess; ++idx)
+        if (firstInputToProcess <= lastInputToProcess)
+            delta( firstInputToProcess, lastInputToProcess - firstInputToProcess + 1 );
+
+        // compute statistics on inputs & deltas
+        const int rowCount = m_rowsDropped + deltaCount();
+        while (true)
         {
-            DeltaFeatures deltaFeatures;
-            deltaFeatures[ENTROPY_DELTA] = delta( vector(ENTROPY, idx, deltaFilterSize) );
-            deltaFeatures[MFCC2_DELTA] = delta( vector(MFCC2, idx, deltaFilterSize) );
-            deltaFeatures[MFCC3_DELTA] = delta( vector(MFCC3, idx, deltaFilterSize) );
-            deltaFeatures[MFCC4_DELTA] = delta( vector(MFCC4, idx, deltaFilterSize) );
+            int end = m_nextWindowEnd;
+            if (end > rowCount) {
+                // when flushing, any window of a remaining frame
+                if (!m_flushing || end - m_lookahead - 1 >= rowCount)
+                    break;
+                end = rowCount;
+            }
+            const int begin = std::max( m_nextWindowEnd - m_windowSize, 0 );
+
+            if (m_incremental)
+                outBuffer.push_back( runningStatistics( begin - m_rowsDropped, end - m_rowsDropped ) );
+            else
+                outBuffer.push_back( windowStatistics( begin - m_rowsDropped, end - m_rowsDropped ) );
 
-            m_deltaBuffer.push_back( deltaFeatures );
+            m_nextWindowEnd += m_stepSize;
         }
 
-        // compute statistics on inputs & deltas
-        const int lastDeltaToProcess = (int) m_deltaBuffer.size() - m_windowSize;
-        int idx;
-        for (idx = 0; idx <= lastDeltaToProcess; idx += m_stepSize)
-        {
-            int input_idx = idx + m_halfFilterLen;
-
-            Vector gate_vector = vector(ENERGY_GATE, input_idx, m_windowSize);
-
-#define INPUT_VECTOR( feature ) \
-    vector(feature, input_idx, m_windowSize), gate_vector
-
-#define DELTA_VECTOR( feature ) \
-    vector(feature, idx, m_windowSize), gate_vector
-
-            OutputFeatures output;
-
-            output[ENTROPY_MEAN] = mean( INPUT_VECTOR( ENTROPY ) );
-            output[PITH_DENSITY_MEAN] = mean( INPUT_VECTOR( PITCH_DENSITY ) );
-            output[TONALITY_MEAN] = mean( INPUT_VECTOR( TONALITY ) );
-            output[TONALITY1_MEAN] = mean( INPUT_VECTOR( TONALITY1 ) );
-            output[FOUR_HZ_MOD_MEAN] = mean( INPUT_VECTOR( FOUR_HZ_MOD ) );
-            output[MFCC2_MEAN] = mean( INPUT_VECTOR( MFCC2 ) );
-            output[MFCC3_MEAN] = mean( INPUT_VECTOR( MFCC3 ) );
-            output[MFCC4_MEAN] = mean( INPUT_VECTOR( MFCC4 ) );
-            output[ENTROPY_DELTA_VAR] = variance( DELTA_VECTOR( ENTROPY_DELTA ) );
-            float tonalityMean = output[TONALITY_MEAN];
-            float tonalityVar = variance( INPUT_VECTOR( TONALITY ), tonalityMean );
-            output[TONALITY_FLUCT] = tonalityMean != 0.f ? tonalityVar / (tonalityMean * tonalityMean) : 0.f;
-            output[MFCC2_STD] = stdDev( INPUT_VECTOR( MFCC2 ), output[MFCC2_MEAN] );
-            output[MFCC3_STD] = stdDev( INPUT_VECTOR( MFCC3 ), output[MFCC3_MEAN] );
-            output[MFCC4_STD] = stdDev( INPUT_VECTOR( MFCC4 ), output[MFCC4_MEAN] );
-            output[MFCC2_DELTA_STD] = stdDev( DELTA_VECTOR( MFCC2_DELTA ) );
-            output[MFCC3_DELTA_STD] = stdDev( DELTA_VECTOR( MFCC3_DELTA ) );
-            output[MFCC4_DELTA_STD] = stdDev( DELTA_VECTOR( MFCC4_DELTA ) );
-
-            float gate_mean = 0.f;
-            float *gate_data = gate_vector.data;
-            for (int i = 0; i < gate_vector.samples; ++i, gate_data += gate_vector.observations)
-                gate_mean += *gate_data;
-            gate_mean /= gate_vector.samples;
-            output[ENERGY_GATE_MEAN] = gate_mean;
-
-            outBuffer.push_back(output);
-
-#undef INPUT_VECTOR
-#undef DELTA_VECTOR
+        // remove inputs & deltas before the next window
+        const int drop = std::min( std::max( m_nextWindowEnd - m_windowSize, 0 ) - m_rowsDropped,
+                                   deltaCount() );
+        if (drop <= 0)
+            return;
+
+        if (m_runningValid) {
+            if (drop <= m_runningEnd) {
+                for (; m_runningBegin < drop; ++m_runningBegin)
+                    accumulate( m_runningBegin, -1.0 );
+            }
+            else {
+                m_runningValid = false;
+            }
         }
 
-        // remove processed inputs & deltas
-        m_inputBuffer.erase( m_inputBuffer.begin(), m_inputBuffer.begin() + idx );
-        m_deltaBuffer.erase( m_deltaBuffer.begin(), m_deltaBuffer.begin() + idx );
+        for (int f = 0; f < INPUT_FEATURE_COUNT; ++f)
+            m_inputBuffer[f].pop_front( drop );
+        for (int f = 0; f < DELTA_FEATURE_COUNT; ++f)
+            m_deltaBuffer[f].pop_front( drop );
+        m_gateMask.pop_front( drop );
+        m_rowsDropped += drop;
+        m_runningBegin -= drop;
+        m_runningEnd -= drop;
     }
 
-    Vector vector( InputFeature feature, int idx, int count )
+    // Statistics of delta rows [begin, end),
+    // with one masked pass over the window of all features
+    OutputFeatures windowStatistics( int begin, int end )
     {
-        return Vector(m_inputBuffer, idx, count, feature);
-    }
+        const int count = end - begin;
+        const int input_idx = begin + m_inputOffset;
+        const float *gate = m_gateMask.data( input_idx );
+
+        const float *columns[MOMENT_COLUMN_COUNT];
+        for (int f = ENTROPY; f < INPUT_FEATURE_COUNT; ++f)
+            columns[f - ENTROPY] = m_inputBuffer[f].data( input_idx );
+        for (int f = 0; f < DELTA_FEATURE_COUNT; ++f)
+            columns[INPUT_FEATURE_COUNT - ENTROPY + f] = m_deltaBuffer[f].data( begin );
+
+        // Values are taken relative to the first gated row, so that
+        // the variance does not cancel out in single precision.
+        int first = 0;
+        while (first < count && gate[first] == 0.f)
+            ++first;
+        float shift[MOMENT_COLUMN_COUNT];
+        for (int c = 0; c < MOMENT_COLUMN_COUNT; ++c)
+            shift[c] = first < count ? columns[c][first] : 0.f;
+
+        float sums[1 + 2 * MOMENT_COLUMN_COUNT];
+        kernels().maskedMoments( columns, shift, MOMENT_COLUMN_COUNT, gate, count, sums );
+
+#define INPUT_MOMENTS( feature ) \
+    moments( sums, shift, feature - ENTROPY )
+
+#define DELTA_MOMENTS( feature ) \
+    moments( sums, shift, INPUT_FEATURE_COUNT - ENTROPY + feature )
+
+        const Moments entropy = INPUT_MOMENTS( ENTROPY );
+        const Moments tonality = INPUT_MOMENTS( TONALITY );
+        const Moments mfcc2 = INPUT_MOMENTS( MFCC2 );
+        const Moments mfcc3 = INPUT_MOMENTS( MFCC3 );
+        const Moments mfcc4 = INPUT_MOMENTS( MFCC4 );
+
+        OutputFeatures output;
+
+        output[ENTROPY_MEAN] = entropy.mean;
+        output[PITH_DENSITY_MEAN] = INPUT_MOMENTS( PITCH_DENSITY ).mean;
+        output[TONALITY_MEAN] = tonality.mean;
+        output[TONALITY1_MEAN] = INPUT_MOMENTS( TONALITY1 ).mean;
+        output[FOUR_HZ_MOD_MEAN] = INPUT_MOMENTS( FOUR_HZ_MOD ).mean;
+        output[MFCC2_MEAN] = mfcc2.mean;
+        output[MFCC3_MEAN] = mfcc3.mean;
+        output[MFCC4_MEAN] = mfcc4.mean;
+        output[ENTROPY_DELTA_VAR] = DELTA_MOMENTS( ENTROPY_DELTA ).variance;
+        float tonalityMean = tonality.mean;
+        output[TONALITY_FLUCT] = tonalityMean != 0.f ? tonality.variance / (tonalityMean * tonalityMean) : 0.f;
+        output[MFCC2_STD] = std::sqrt( mfcc2.variance );
+        output[MFCC3_STD] = std::sqrt( mfcc3.variance );
+        output[MFCC4_STD] = std::sqrt( mfcc4.variance );
+        output[MFCC2_DELTA_STD] = std::sqrt( DELTA_MOMENTS( MFCC2_DELTA ).variance );
+        output[MFCC3_DELTA_STD] = std::sqrt( DELTA_MOMENTS( MFCC3_DELTA ).variance );
+        output[MFCC4_DELTA_STD] = std::sqrt( DELTA_MOMENTS( MFCC4_DELTA ).variance );
+        output[ENERGY_GATE_MEAN] = entropy.count / count;
+
+#undef INPUT_MOMENTS
+#undef DELTA_MOMENTS
 
-    Vector vector( DeltaFeature feature, int idx, int count )
-    {
-        return Vector(m_deltaBuffer, idx, count, feature);
+        return output;
     }
 
-    void initDeltaFilter( int filterLen )
+    struct Moments {
+        float count;
+        float mean;
+        float variance;
+    };
+
+    // Gated count, mean and variance of a column, from the sums of maskedMoments
+    static Moments moments( const float *sums, const float *shift, int column )
     {
-        int halfFilterLen = (filterLen - 1) / 2;
-        m_deltaFilter.resize(2 * halfFilterLen + 1);
-        float sum = 0;
-        for (int i = -halfFilterLen; i <= halfFilterLen; ++i)
-            sum += i*i;
-        for (int i = -halfFilterLen; i <= halfFilterLen; ++i)
-            m_deltaFilter[ halfFilterLen + i ] = i / sum;
-        m_halfFilterLen = halfFilterLen;
+        const float n = sums[0];
+        const float s = sums[1 + 2 * column];
+        const float q = sums[2 + 2 * column];
+
+        Moments result = { n, 0.f, 0.f };
+        if (n > 0.f)
+            result.mean = shift[column] + s / n;
+        if (n > 1.f)
+            result.variance = std::max( (q - s * s / n) / (n - 1.f), 0.f );
+        return result;
     }
 
-    float delta( const Vector & feature_vector )
+    // Statistics of delta rows [begin, end), from running sums
+    // updated with the rows entering and leaving the window
+    OutputFeatures runningStatistics( int begin, int end )
     {
-        int filter_size = m_deltaFilter.size();
-        float *feature_data = feature_vector.data;
-        float output = 0;
-        for (int idx = 0; idx < filter_size; ++idx, feature_data += feature_vector.observations)
-            output += *feature_data * m_deltaFilter[idx];
+        if (m_runningValid && begin >= m_runningBegin && begin <= m_runningEnd) {
+            for (; m_runningBegin < begin; ++m_runningBegin)
+                accumulate( m_runningBegin, -1.0 );
+        }
+        if (!m_runningValid || begin != m_runningBegin || m_rowsSinceAnchor >= m_windowSize)
+            anchorRunningSums( begin );
+        for (; m_runningEnd < end; ++m_runningEnd, ++m_rowsSinceAnchor)
+            accumulate( m_runningEnd, 1.0 );
+
+        const RunningSums & r = m_running;
+        const int n = (int) r.count;
+
+        OutputFeatures output;
+
+        output[ENTROPY_MEAN] = runningMean( ENTROPY );
+        output[PITH_DENSITY_MEAN] = runningMean( PITCH_DENSITY );
+        output[TONALITY_MEAN] = runningMean( TONALITY );
+        output[TONALITY1_MEAN] = runningMean( TONALITY1 );
+        output[FOUR_HZ_MOD_MEAN] = runningMean( FOUR_HZ_MOD );
+        output[MFCC2_MEAN] = runningMean( MFCC2 );
+        output[MFCC3_MEAN] = runningMean( MFCC3 );
+        output[MFCC4_MEAN] = runningMean( MFCC4 );
+        output[ENTROPY_DELTA_VAR] = runningVariance( INPUT_FEATURE_COUNT + ENTROPY_DELTA );
+        float tonalityMean = output[TONALITY_MEAN];
+        float tonalityVar = runningVariance( TONALITY );
+        output[TONALITY_FLUCT] = tonalityMean != 0.f ? tonalityVar / (tonalityMean * tonalityMean) : 0.f;
+        output[MFCC2_STD] = std::sqrt( runningVariance( MFCC2 ) );
+        output[MFCC3_STD] = std::sqrt( runningVariance( MFCC3 ) );
+        output[MFCC4_STD] = std::sqrt( runningVariance( MFCC4 ) );
+        output[MFCC2_DELTA_STD] = std::sqrt( runningVariance( INPUT_FEATURE_COUNT + MFCC2_DELTA ) );
+        output[MFCC3_DELTA_STD] = std::sqrt( runningVariance( INPUT_FEATURE_COUNT + MFCC3_DELTA ) );
+        output[MFCC4_DELTA_STD] = std::sqrt( runningVariance( INPUT_FEATURE_COUNT + MFCC4_DELTA ) );
+        output[ENERGY_GATE_MEAN] = (float) n / (end - begin);
+
         return output;
     }
 
-    float mean ( const Vector & feature_vector, const Vector & gate_vector )
+    // Starts running sums over no rows at 'idx', shifted by the means of the last window,
+    // or by the last shift where a mean is not finite
+    void anchorRunningSums( int idx )
     {
-        assert(feature_vector.samples == gate_vector.samples);
-        float *feature_data = feature_vector.data;
-        float *gate_data = gate_vector.data;
-        float mean = 0.f;
-        int count = 0;
-        for (int i = 0; i < feature_vector.samples; ++i,
-             feature_data += feature_vector.observations, gate_data += gate_vector.observations)
-        {
-            if (*gate_data == 1.f) {
-                mean += *feature_data;
-                ++count;
+        RunningSums & r = m_running;
+        for (int f = 0; f < COLUMN_COUNT; ++f) {
+            double shift = 0.0;
+            if (m_runningValid && r.count > 0) {
+                shift = r.shift[f] + r.sum[f] / r.count;
+                if (!std::isfinite( shift ))
+                    shift = r.shift[f];
             }
+            r.shift[f] = shift;
+            r.sum[f] = r.sumOfSquares[f] = 0.0;
         }
-        if (count)
-            mean /= count;
-        return mean;
+        r.count = 0.0;
+        m_runningValid = true;
+        m_runningBegin = m_runningEnd = idx;
+        m_rowsSinceAnchor = 0;
     }
 
-    float variance ( const Vector & feature_vector, const Vector & gate_vector )
+    // Adds (sign = 1) or removes (sign = -1) a delta row and its input row.
+    // Removing a non-finite value leaves the sums non-finite, as in the windowed
+    // mode only while the window holds the value, so they are summed anew.
+    void accumulate( int row, double sign )
     {
-        float m = mean( feature_vector, gate_vector );
-        return variance( feature_vector, gate_vector, m );
+        const int input_row = row + m_inputOffset;
+        if (m_gateMask[input_row] == 0.f)
+            return;
+
+        RunningSums & r = m_running;
+
+        r.count += sign;
+        for (int f = 0; f < COLUMN_COUNT; ++f) {
+            double x = f < INPUT_FEATURE_COUNT ? m_inputBuffer[f][input_row]
+                                               : m_deltaBuffer[f - INPUT_FEATURE_COUNT][row];
+            double d = x - r.shift[f];
+            r.sum[f] += sign * d;
+            r.sumOfSquares[f] += sign * d * d;
+            if (sign < 0 && !std::isfinite( d ))
+                m_rowsSinceAnchor = m_windowSize;
+        }
     }
 
-    float variance ( const Vector & feature_vector, const Vector & gate_vector, float mean )
+    float runningMean( int feature ) const
     {
-        assert(feature_vector.samples == gate_vector.samples);
-        float *feature_data = feature_vector.data;
-        float *gate_data = gate_vector.data;
-        float variance = 0.f;
-        int count = 0;
-        for (int i = 0; i < feature_vector.samples; ++i,
-             feature_data += feature_vector.observations, gate_data += gate_vector.observations)
-        {
-            if (*gate_data == 1.f) {
-                float dev = *feature_data - mean;
-                variance += dev * dev;
-                ++count;
-            }
-        }
-        if (count > 1)
-            variance /= count - 1;
-        else
-            variance = 0.f;
-        return variance;
+        const RunningSums & r = m_running;
+        if (r.count < 1)
+            return 0.f;
+        return r.shift[feature] + r.sum[feature] / r.count;
     }
 
-    float stdDev ( const Vector & feature_vector, const Vector & gate_vector, float mean )
+    float runningVariance( int feature ) const
     {
-        float var = variance( feature_vector, gate_vector, mean );
-        return std::sqrt(var);
+        const RunningSums & r = m_running;
+        if (r.count < 2)
+            return 0.f;
+        double variance = (r.sumOfSquares[feature] - r.sum[feature] * r.sum[feature] / r.count) / (r.count - 1);
+        return std::max( variance, 0.0 );
     }
 
-    float stdDev ( const Vector & feature_vector, const Vector & gate_vector )
+    void initDeltaFilter( int filterLen )
     {
-        float var = variance( feature_vector, gate_vector );
-        return std::sqrt(var);
+        m_deltaFilter = DeltaFilter( filterLen );
+        m_halfFilterLen = m_deltaFilter.halfLength();
+    }
+
+    // Appends deltas of inputs [idx, idx + count) to the delta buffer
+    void delta( int idx, int count )
+    {
+        static const InputFeature deltaInputs[DELTA_FEATURE_COUNT] = { ENTROPY, MFCC2, MFCC3, MFCC4 };
+
+        const float *inputs[DELTA_FEATURE_COUNT];
+        float *outputs[DELTA_FEATURE_COUNT];
+        const int stride = m_deltaBlock.size() / DELTA_FEATURE_COUNT;
+        for (int f = 0; f < DELTA_FEATURE_COUNT; ++f) {
+            inputs[f] = m_inputBuffer[deltaInputs[f]].data( idx );
+            outputs[f] = m_deltaBlock.data() + f * stride;
+        }
+
+        m_deltaFilter.process( inputs, DELTA_FEATURE_COUNT, count, outputs );
+
+        for (int f = 0; f < DELTA_FEATURE_COUNT; ++f)
+            for (int i = 0; i < count; ++i)
+                m_deltaBuffer[f].push_back( outputs[f][i] );
     }
 };
 
@@ -0,0 +1,100 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "tables.hpp"
+#include "mel_spectrum.hpp"
+#include "entropy.hpp"
+
+#include <cmath>
+
+namespace Segmenter {
+namespace Tables {
+
+void buildHammingWindow( int size, std::vector<float> & window )
+{
+    const double pi = Segmenter::pi();
+    window.resize(size);
+    for (int idx = 0; idx < size; ++idx)
+        window[idx] = 0.54 - 0.46 * std::cos(2 * pi * idx / (size - 1) );
+}
+
+void buildPrunedTwiddles( int windowSize, BinRange range, int decimation, std::vector<float> & twiddles )
+{
+    const double pi = Segmenter::pi();
+    twiddles.resize( range.size() * decimation * 2 );
+    float *twiddle = twiddles.data();
+    for (int bin = range.begin; bin < range.end; ++bin) {
+        for (int r = 0; r < decimation; ++r) {
+            double phase = 2 * pi * ((long long) r * bin % windowSize) / windowSize;
+            *twiddle++ = std::cos(phase);
+            *twiddle++ = -std::sin(phase);
+        }
+    }
+}
+
+void buildCosineRows( int size, const std::vector<int> & rows, double scale, std::vector<float> & table )
+{
+    const double pi = Segmenter::pi();
+    const int rowCount = rows.size();
+    table.resize( rowCount * size );
+    for (int row = 0; row < rowCount; ++row) {
+        const int k = rows[row];
+        const double rowScale = k == 0 ? 1.0 / std::sqrt(2.0) : 1.0;
+        for (int n = 0; n < size; ++n)
+            table[row * size + n] = scale * rowScale * std::cos( pi * k * (n + 0.5) / size );
+    }
+}
+
+void buildModulationBasis( float sampleRate, int hopSize, double frequency, ModulationBasis & basis )
+{
+    const double pi = Segmenter::pi();
+
+    double dt = hopSize / (double) sampleRate;
+    int length = std::ceil( 0.5 / dt );
+    double w = frequency * 2 * pi * dt;
+
+    basis.length = length;
+    basis.re.resize(length);
+    basis.im.resize(length);
+    for (int i = 0; i < length; ++i) {
+        basis.re[i] = std::cos( w * i );
+        basis.im[i] = std::sin( w * i );
+    }
+    basis.rotateRe = std::cos( w );
+    basis.rotateIm = - std::sin( w );
+    basis.enterRe = std::cos( w * length );
+    basis.enterIm = std::sin( w * length );
+}
+
+void buildMelFilterBank( int bandCount, int windowSize, float sampleRate,
+                         double loFreq, double hiFreq, SparseFilterBank & filterBank )
+{
+    MelSpectrum::initMelFilters( bandCount, windowSize, sampleRate, loFreq, hiFreq, filterBank );
+}
+
+void buildChromaticFilterBank( int loFreq, int hiFreq, float sampleRate, int spectrumSize,
+                               ChromaticFilters & filters )
+{
+    ChromaticEntropy::initFilter( loFreq, hiFreq, sampleRate, spectrumSize,
+                                  filters.filterBank, filters.frequencies );
+}
+
+} // namespace Tables
+} // namespace Segmenter
@@ -0,0 +1,182 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "tables.hpp"
+
+#ifdef SEGMENTER_DEFAULT_TABLES
+// Generated at build time by generate-tables
+#include "default_tables.hpp"
+#endif
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace Segmenter {
+namespace Tables {
+
+namespace {
+
+// Weak references to the tables in use, by key
+template <typename Key, typename Table>
+class Cache
+{
+    typedef std::map< Key, std::weak_ptr<const Table> > Map;
+
+    std::mutex m_mutex;
+    Map m_tables;
+
+public:
+    typedef std::shared_ptr<const Table> Pointer;
+
+    // Returns the table for 'key', or a new one made by build(table)
+    template <typename Builder>
+    Pointer get( const Key & key, Builder build )
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        typename Map::iterator it = m_tables.find(key);
+        if (it != m_tables.end()) {
+            Pointer table = it->second.lock();
+            if (table)
+                return table;
+        }
+
+        // Forget tables no longer in use
+        for (typename Map::iterator expired = m_tables.begin(); expired != m_tables.end(); ) {
+            if (expired->second.expired())
+                m_tables.erase(expired++);
+            else
+                ++expired;
+        }
+
+        Table *table = new Table();
+        build(*table);
+        Pointer pointer(table);
+        m_tables[key] = pointer;
+        return pointer;
+    }
+};
+
+} // namespace
+
+FloatTable hammingWindow( int size )
+{
+    static Cache< int, std::vector<float> > cache;
+    return cache.get( size, [&]( std::vector<float> & window ) {
+#ifdef SEGMENTER_DEFAULT_TABLES
+        namespace Default = DefaultTables::HammingWindow;
+        if (size == Default::size) {
+            window.assign( Default::values, Default::values + size );
+            return;
+        }
+#endif
+        buildHammingWindow( size, window );
+    });
+}
+
+FloatTable prunedTwiddles( int windowSize, BinRange range, int decimation )
+{
+    typedef std::tuple<int, int, int, int> Key;
+    static Cache< Key, std::vector<float> > cache;
+    return cache.get( Key(windowSize, range.begin, range.end, decimation),
+                      [&]( std::vector<float> & twiddles ) {
+        buildPrunedTwiddles( windowSize, range, decimation, twiddles );
+    });
+}
+
+FloatTable cosineRows( int size, const std::vector<int> & rows, double scale )
+{
+    typedef std::tuple< int, std::vector<int>, double > Key;
+    static Cache< Key, std::vector<float> > cache;
+    return cache.get( Key(size, rows, scale), [&]( std::vector<float> & table ) {
+        buildCosineRows( size, rows, scale, table );
+    });
+}
+
+FilterBankTable melFilterBank( int bandCount, int windowSize, float sampleRate,
+                               double loFreq, double hiFreq )
+{
+    typedef std::tuple<int, int, float, double, double> Key;
+    static Cache< Key, SparseFilterBank > cache;
+    return cache.get( Key(bandCount, windowSize, sampleRate, loFreq, hiFreq),
+                      [&]( SparseFilterBank & filterBank ) {
+#ifdef SEGMENTER_DEFAULT_TABLES
+        namespace Default = DefaultTables::MelFilterBank;
+        if (bandCount == Default::bandCount && windowSize == Default::windowSize &&
+            sampleRate == Default::sampleRate && loFreq == Default::loFreq && hiFreq == Default::hiFreq)
+        {
+            filterBank = SparseFilterBank( Default::inputSize, bandCount, Default::rowPointers,
+                                           Default::columnOffsets, Default::coefficients );
+            return;
+        }
+#endif
+        buildMelFilterBank( bandCount, windowSize, sampleRate, loFreq, hiFreq, filterBank );
+    });
+}
+
+std::shared_ptr<const ChromaticFilters> chromaticFilterBank( int loFreq, int hiFreq, float sampleRate,
+                                                             int spectrumSize )
+{
+    typedef std::tuple<int, int, float, int> Key;
+    static Cache< Key, ChromaticFilters > cache;
+    return cache.get( Key(loFreq, hiFreq, sampleRate, spectrumSize),
+                      [&]( ChromaticFilters & filters ) {
+#ifdef SEGMENTER_DEFAULT_TABLES
+        namespace Default = DefaultTables::ChromaticFilterBank;
+        if (loFreq == Default::loFreq && hiFreq == Default::hiFreq &&
+            sampleRate == Default::sampleRate && spectrumSize == Default::spectrumSize)
+        {
+            filters.filterBank = SparseFilterBank( Default::inputSize, Default::filterCount, Default::rowPointers,
+                                                   Default::columnOffsets, Default::coefficients );
+            filters.frequencies.assign( Default::frequencies,
+                                        Default::frequencies + Default::frequencyCount );
+            return;
+        }
+#endif
+        buildChromaticFilterBank( loFreq, hiFreq, sampleRate, spectrumSize, filters );
+    });
+}
+
+std::shared_ptr<const ModulationBasis> modulationBasis( float sampleRate, int hopSize, double frequency )
+{
+    typedef std::tuple<float, int, double> Key;
+    static Cache< Key, ModulationBasis > cache;
+    return cache.get( Key(sampleRate, hopSize, frequency), [&]( ModulationBasis & basis ) {
+#ifdef SEGMENTER_DEFAULT_TABLES
+        namespace Default = DefaultTables::ModulationBasis;
+        if (sampleRate == Default::sampleRate && hopSize == Default::hopSize && frequency == Default::frequency)
+        {
+            basis.length = Default::length;
+            basis.re.assign( Default::re, Default::re + Default::length );
+            basis.im.assign( Default::im, Default::im + Default::length );
+            basis.rotateRe = Default::rotateRe;
+            basis.rotateIm = Default::rotateIm;
+            basis.enterRe = Default::enterRe;
+            basis.enterIm = Default::enterIm;
+            return;
+        }
+#endif
+        buildModulationBasis( sampleRate, hopSize, frequency, basis );
+    });
+}
+
+} // namespace Tables
+} // namespace Segmenter
@@ -0,0 +1,101 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_TABLES_HPP_INCLUDED
+#define SEGMENTER_TABLES_HPP_INCLUDED
+
+#include "module.hpp"
+#include "filter_bank.hpp"
+
+#include <vector>
+#include <memory>
+
+namespace Segmenter {
+
+/*
+    Immutable tables derived from the configuration of modules.
+
+    The getters return tables from a process-wide cache, so that modules
+    with the same parameters share one copy, e.g. across many Pipeline or
+    plugin instances. Tables are reference-counted: the cache only holds
+    weak references, and a table is freed with the last module using it.
+    The getters are thread-safe.
+
+    The build functions compute a table without the cache, and do not
+    depend on FFTW. When built with SEGMENTER_DEFAULT_TABLES, the tables of
+    the default configuration (11025 Hz, 512 sample blocks, 256 sample hop)
+    are taken from the header generated with them at build time instead.
+*/
+namespace Tables {
+
+typedef std::shared_ptr< const std::vector<float> > FloatTable;
+typedef std::shared_ptr< const SparseFilterBank > FilterBankTable;
+
+// Hamming window of 'size' samples
+FloatTable hammingWindow( int size );
+void buildHammingWindow( int size, std::vector<float> & window );
+
+// W_N^(r k) of a pruned transform of 'windowSize', as (cos, -sin) pairs,
+// for each bin k in 'range' and subsequence r in [0, decimation)
+FloatTable prunedTwiddles( int windowSize, BinRange range, int decimation );
+void buildPrunedTwiddles( int windowSize, BinRange range, int decimation, std::vector<float> & twiddles );
+
+// Rows k of FFTW's REDFT10 of 'size' for k in 'rows', multiplied by 'scale',
+// and by 1 / sqrt(2) for k = 0
+FloatTable cosineRows( int size, const std::vector<int> & rows, double scale );
+void buildCosineRows( int size, const std::vector<int> & rows, double scale, std::vector<float> & table );
+
+// Mel filters of MelSpectrum::initMelFilters
+FilterBankTable melFilterBank( int bandCount, int windowSize, float sampleRate,
+                               double loFreq, double hiFreq );
+void buildMelFilterBank( int bandCount, int windowSize, float sampleRate,
+                         double loFreq, double hiFreq, SparseFilterBank & filterBank );
+
+// Semitone filters of ChromaticEntropy::initFilter, with their frequencies
+struct ChromaticFilters
+{
+    SparseFilterBank filterBank;
+    std::vector<float> frequencies;
+};
+
+std::shared_ptr<const ChromaticFilters> chromaticFilterBank( int loFreq, int hiFreq, float sampleRate,
+                                                             int spectrumSize );
+void buildChromaticFilterBank( int loFreq, int hiFreq, float sampleRate, int spectrumSize,
+                               ChromaticFilters & filters );
+
+// exp(j w i) for i in [0, length), for modulation at 'frequency'
+// over frames 'hopSize' samples apart, spanning half a second
+struct ModulationBasis
+{
+    int length;
+    std::vector<double> re;
+    std::vector<double> im;
+    double rotateRe, rotateIm; // exp(-j w)
+    double enterRe, enterIm;   // exp(j w length)
+};
+
+std::shared_ptr<const ModulationBasis> modulationBasis( float sampleRate, int hopSize, double frequency );
+void buildModulationBasis( float sampleRate, int hopSize, double frequency, ModulationBasis & basis );
+
+} // namespace Tables
+
+} // namespace Segmenter
+
+#endif // SEGMENTER_TABLES_HPP_INCLUDED
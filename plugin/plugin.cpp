@@ -20,11 +20,14 @@
 
 #include "plugin.hpp"
 #include "../modules/pipeline.hpp"
+#include "../modules/kernels.hpp"
 
 #include <vamp/vamp.h>
 
 #include <sstream>
 #include <iostream>
+#include <cstdlib>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -237,9 +240,55 @@ void Plugin::createPipeline()
     statCtx.blockSize = 3 * fCtx.sampleRate / fCtx.stepSize;
     statCtx.stepSize = statCtx.blockSize / 6;
 
-    std::cout << "*** Segmenter: blocksize=" << fCtx.blockSize << " stepSize=" << fCtx.stepSize << std::endl;
+    std::cout << "*** Segmenter: blocksize=" << fCtx.blockSize << " stepSize=" << fCtx.stepSize
+              << " kernels=" << kernels().name << std::endl;
 
     m_pipeline = new Pipeline( inCtx, fCtx, statCtx );
+
+    m_modelStamp = ModelStamp();
+    updateModel( true );
+}
+
+// Classifies with the model file given by the SEGMENTER_MODEL environment variable,
+// if any, and loads it again when it changes, checking at most once a second.
+// To change the model while running, write a new file and rename it over the old one.
+void Plugin::updateModel( bool force )
+{
+    const char * filename = std::getenv("SEGMENTER_MODEL");
+    if (!filename || !*filename)
+        return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!force && now - m_modelCheckTime < std::chrono::seconds(1))
+        return;
+    m_modelCheckTime = now;
+
+    struct stat status;
+    if (stat( filename, &status ) != 0)
+        return;
+
+    ModelStamp stamp;
+    stamp.inode = status.st_ino;
+    stamp.size = status.st_size;
+    stamp.seconds = status.st_mtime;
+#if defined(__APPLE__)
+    stamp.nanoseconds = status.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    stamp.nanoseconds = status.st_mtim.tv_nsec;
+#endif
+    if (stamp == m_modelStamp)
+        return;
+
+    // a file caught while being written is tried again at the next check
+    std::shared_ptr<const ClassifierModel> model = ClassifierModel::load( filename );
+    if (model && m_pipeline->setClassifierModel( model )) {
+        m_modelStamp = stamp;
+        std::cout << "*** Segmenter: model=" << filename << std::endl;
+    }
+    else if (!(stamp == m_failedModelStamp)) {
+        m_failedModelStamp = stamp;
+        std::cout << "*** WARNING: Segmenter: Can not use classifier model: " << filename << std::endl;
+    }
 }
 
 Vamp::Plugin::FeatureSet Plugin::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
@@ -262,6 +311,7 @@ Vamp::Plugin::FeatureSet Plugin::getFeatures(const float * input, Vamp::RealTime
     else
         m_pipeline->computeStatistics( 0, 0, endOfStream );
 
+    updateModel();
     m_pipeline->computeClassification( features[0] );
 
     for (int i = 0; i < m_pipeline->statistics().size(); ++i)
@@ -24,6 +24,7 @@
 #include <vamp-sdk/Plugin.h>
 #include <vector>
 #include <fstream>
+#include <chrono>
 
 namespace Segmenter {
 
@@ -65,6 +66,7 @@ public:
 
 private:
     void createPipeline();
+    void updateModel( bool force = false );
 
     FeatureSet getFeatures(const float * input, Vamp::RealTime timestamp);
 
@@ -72,6 +74,24 @@ private:
 
     Pipeline * m_pipeline;
 
+    // Version of a model file, changed by writing or replacing it
+    struct ModelStamp {
+        ModelStamp(): inode(0), size(0), seconds(0), nanoseconds(0) {}
+        bool operator == ( const ModelStamp & other ) const
+        {
+            return inode == other.inode && size == other.size
+                && seconds == other.seconds && nanoseconds == other.nanoseconds;
+        }
+        unsigned long long inode;
+        long long size;
+        long long seconds;
+        long nanoseconds;
+    };
+
+    ModelStamp m_modelStamp;
+    ModelStamp m_failedModelStamp;
+    std::chrono::steady_clock::time_point m_modelCheckTime;
+
     Vamp::RealTime m_featureDuration;
     Vamp::RealTime m_featureTime;
 
@@ -0,0 +1,105 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#ifndef SEGMENTER_TEST_CHECKS_HPP_INCLUDED
+#define SEGMENTER_TEST_CHECKS_HPP_INCLUDED
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cstdio>
+
+namespace Test {
+
+// Counts checks and reports the failed ones
+struct Checks
+{
+    int count;
+    int failures;
+
+    Checks(): count(0), failures(0) {}
+
+    void check( bool passed, const std::string & what )
+    {
+        ++count;
+        if (!passed) {
+            ++failures;
+            std::cout << "\tFAILED: " << what << std::endl;
+        }
+    }
+
+    // Prints the summary; returns the exit code of the test
+    int finish( const std::string & name ) const
+    {
+        std::cout << "-- " << name << ": " << count - failures << " of " << count
+                  << " checks passed" << std::endl;
+        return failures ? 1 : 0;
+    }
+};
+
+inline std::string readFile( const std::string & filename )
+{
+    std::ifstream in( filename.c_str(), std::ios::in | std::ios::binary );
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+inline bool writeFile( const std::string & filename, const std::string & contents )
+{
+    std::ofstream out( filename.c_str(), std::ios::out | std::ios::binary );
+    out.write( contents.data(), contents.size() );
+    return (bool) out;
+}
+
+// 'contents' with 'value' written over it at 'offset'
+template <typename T>
+std::string patched( std::string contents, size_t offset, T value )
+{
+    if (offset + sizeof(value) <= contents.size())
+        std::memcpy( &contents[offset], &value, sizeof(value) );
+    return contents;
+}
+
+// Named damaged copies of a file
+typedef std::vector< std::pair<std::string, std::string> > DamagedFiles;
+
+// Writes each damaged copy to 'filename' and checks that 'rejects( filename )' holds,
+// then removes the file and checks that a missing file is rejected as well.
+template <typename Rejects>
+void checkRejected( Checks & checks, const std::string & filename,
+                    const DamagedFiles & damaged, Rejects rejects )
+{
+    for (size_t d = 0; d < damaged.size(); ++d) {
+        checks.check( writeFile( filename, damaged[d].second ), "write " + filename );
+        checks.check( rejects( filename ), "reject " + damaged[d].first + " file" );
+    }
+
+    std::remove( filename.c_str() );
+    checks.check( rejects( filename ), "reject missing file" );
+}
+
+} // namespace Test
+
+#endif // SEGMENTER_TEST_CHECKS_HPP_INCLUDED
@@ -0,0 +1,114 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "checks.hpp"
+#include "../modules/classification.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+using namespace Segmenter;
+
+typedef ClassifierModel::FileHeader Header;
+
+// Saves each builtin classifier model, loads it back and compares its coefficients
+// and classification, then loads copies of the file with damaged headers and data.
+int main()
+{
+    Test::Checks checks;
+    const string filename = "classifier-model-test.segmodel";
+
+    for (int m = 0; m < ClassifierModel::BuiltinModelCount; ++m)
+    {
+        const ClassifierModel::Builtin which = (ClassifierModel::Builtin) m;
+        const std::shared_ptr<const ClassifierModel> builtin = ClassifierModel::builtin( which );
+        const string name = ClassifierModel::builtinFileName( which );
+
+        checks.check( builtin->save( filename ), name + ": save " + filename );
+        std::shared_ptr<const ClassifierModel> loaded = ClassifierModel::load( filename );
+        checks.check( (bool) loaded, name + ": load " + filename );
+        if (!loaded)
+            continue;
+
+        bool same = loaded->inputCount() == builtin->inputCount()
+            && loaded->classNames() == builtin->classNames();
+        for (int row = 0; same && row <= builtin->inputCount(); ++row)
+            for (int logit = 0; logit < builtin->classCount() - 1; ++logit)
+                same = same && loaded->coefficient( row, logit ) == builtin->coefficient( row, logit );
+        checks.check( same, name + ": coefficients read back" );
+
+        // made up statistics, one row per frame
+        const int rows = 37;
+        vector<float> input( rows * builtin->inputCount() );
+        for (size_t i = 0; i < input.size(); ++i)
+            input[i] = (float) ((i * 7919) % 1009) / 1009 - 0.5f;
+
+        Classifier reference( MathContext::Accurate, builtin );
+        Classifier classifier( MathContext::Accurate, loaded );
+        reference.process( input.data(), builtin->inputCount(), rows );
+        classifier.process( input.data(), builtin->inputCount(), rows );
+        checks.check( classifier.probabilities() == reference.probabilities(),
+                      name + ": classification as builtin" );
+    }
+
+    // Damage the file of the default model
+    checks.check( ClassifierModel::builtin()->save( filename ), "save " + filename );
+    const string contents = Test::readFile( filename );
+    Header header = Header();
+    if (contents.size() >= sizeof(header))
+        std::memcpy( &header, contents.data(), sizeof(header) );
+
+    Test::DamagedFiles damaged;
+    damaged.push_back( make_pair( "empty", string() ) );
+    damaged.push_back( make_pair( "truncated header", contents.substr( 0, sizeof(Header) - 1 ) ) );
+    damaged.push_back( make_pair( "truncated names", contents.substr( 0, sizeof(Header) + 2 ) ) );
+    damaged.push_back( make_pair( "truncated coefficients", contents.substr( 0, contents.size() - 1 ) ) );
+    damaged.push_back( make_pair( "wrong magic",
+        Test::patched( contents, offsetof(Header, magic), 'X' ) ) );
+    damaged.push_back( make_pair( "other byte order",
+        Test::patched( contents, offsetof(Header, byteOrder), (uint32_t) 0x04030201 ) ) );
+    damaged.push_back( make_pair( "no inputs",
+        Test::patched( contents, offsetof(Header, inputCount), (int32_t) 0 ) ) );
+    damaged.push_back( make_pair( "oversized input count",
+        Test::patched( contents, offsetof(Header, inputCount), (int32_t) 1 << 30 ) ) );
+    damaged.push_back( make_pair( "single class",
+        Test::patched( contents, offsetof(Header, classCount), (int32_t) 1 ) ) );
+    damaged.push_back( make_pair( "oversized class count",
+        Test::patched( contents, offsetof(Header, classCount), (int32_t) 1 << 30 ) ) );
+    damaged.push_back( make_pair( "wrong panel width",
+        Test::patched( contents, offsetof(Header, panelWidth), (int32_t) ClassifierModel::panelWidth / 2 ) ) );
+    damaged.push_back( make_pair( "oversized names",
+        Test::patched( contents, offsetof(Header, namesSize), (int32_t) 0x7fffffff ) ) );
+    damaged.push_back( make_pair( "negative names size",
+        Test::patched( contents, offsetof(Header, namesSize), (int32_t) -1 ) ) );
+    damaged.push_back( make_pair( "misaligned data",
+        Test::patched( contents, offsetof(Header, dataOffset), header.dataOffset + 4 ) ) );
+    damaged.push_back( make_pair( "data past the end",
+        Test::patched( contents, offsetof(Header, dataOffset), (int32_t) 0x7fffffc0 ) ) );
+    damaged.push_back( make_pair( "names past the data",
+        Test::patched( contents, offsetof(Header, dataOffset), (int32_t) 0 ) ) );
+
+    Test::checkRejected( checks, filename, damaged, []( const string & file ) {
+        return !ClassifierModel::load( file );
+    });
+
+    return checks.finish( "classifier model" );
+}
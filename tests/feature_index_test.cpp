@@ -0,0 +1,103 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "checks.hpp"
+#include "../modules/feature_index.hpp"
+
+#include <algorithm>
+#include <stdint.h>
+
+using namespace std;
+using namespace Segmenter;
+
+// Feature frames of a made up recording, with about 3 in 4 frames passing the gate
+static vector<Statistics::InputFeatures> makeFrames( int count )
+{
+    vector<Statistics::InputFeatures> frames( count );
+    unsigned int random = 1;
+    for (int i = 0; i < count; ++i) {
+        for (int f = 0; f < Statistics::INPUT_FEATURE_COUNT; ++f) {
+            random = random * 1103515245u + 12345u;
+            frames[i].data[f] = 100.f * f + (float) ((random >> 8) & 0xffff) / 0xffff;
+        }
+        random = random * 1103515245u + 12345u;
+        frames[i][Statistics::ENERGY_GATE] = ((random >> 16) & 3) ? 1.f : 0.f;
+    }
+    return frames;
+}
+
+static bool sameSummary( const FeatureIndex::Summary & a, const FeatureIndex::Summary & b )
+{
+    return a.count == b.count && a.mean == b.mean
+        && a.variance == b.variance && a.stdDev == b.stdDev;
+}
+
+// Saves a feature index, loads it back and compares all statistics,
+// then loads damaged copies of the file.
+int main()
+{
+    Test::Checks checks;
+    const string filename = "feature-index-test.index";
+
+    const int frameCount = 1000;
+    const vector<Statistics::InputFeatures> frames = makeFrames( frameCount );
+
+    FeatureIndex index( 11025.0 / 256 );
+    for (int i = 0; i < frameCount; i += 97)
+        index.append( frames.data() + i, std::min( 97, frameCount - i ) );
+    index.finish();
+
+    checks.check( index.save( filename ), "save " + filename );
+
+    FeatureIndex loaded;
+    checks.check( loaded.load( filename ), "load " + filename );
+    checks.check( loaded.frameCount() == index.frameCount() && loaded.frameRate() == index.frameRate(),
+                  "frame count and rate read back" );
+
+    const int ranges[][2] = { { 0, frameCount }, { 13, 500 }, { 499, 501 }, { 999, 1000 }, { 0, 0 } };
+    bool same = true;
+    for (int c = 0; c < FeatureIndex::COLUMN_COUNT; ++c)
+        for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); ++r)
+            same = same && sameSummary( loaded.summary( c, ranges[r][0], ranges[r][1] ),
+                                        index.summary( c, ranges[r][0], ranges[r][1] ) );
+    checks.check( same, "statistics read back" );
+
+    const string contents = Test::readFile( filename );
+    // magic, column count, frame rate, shifts, then the size of the first column of sums
+    const size_t frameRateOffset = 8 + sizeof(int32_t);
+    const size_t countsOffset = frameRateOffset + sizeof(double) + FeatureIndex::COLUMN_COUNT * sizeof(double);
+
+    Test::DamagedFiles damaged;
+    damaged.push_back( make_pair( "empty", string() ) );
+    damaged.push_back( make_pair( "truncated header", contents.substr( 0, countsOffset - 3 ) ) );
+    damaged.push_back( make_pair( "truncated sums", contents.substr( 0, contents.size() / 2 ) ) );
+    damaged.push_back( make_pair( "last byte missing", contents.substr( 0, contents.size() - 1 ) ) );
+    damaged.push_back( make_pair( "wrong magic", Test::patched( contents, 0, 'X' ) ) );
+    damaged.push_back( make_pair( "wrong column count", Test::patched( contents, 8, (int32_t) 3 ) ) );
+    damaged.push_back( make_pair( "negative frame rate", Test::patched( contents, frameRateOffset, -1.0 ) ) );
+    damaged.push_back( make_pair( "oversized count", Test::patched( contents, countsOffset, (int32_t) 0x7fffffff ) ) );
+
+    // A rejected file leaves the loaded index as it was
+    Test::checkRejected( checks, filename, damaged, [&]( const string & file ) {
+        return !loaded.load( file ) && loaded.frameCount() == frameCount;
+    });
+
+    return checks.finish( "feature index" );
+}
@@ -0,0 +1,133 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "checks.hpp"
+#include "../modules/kernels.hpp"
+#include "../modules/mel_spectrum.hpp"
+#include "../modules/entropy.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace Segmenter;
+
+// Mel and chromatic filters stacked as in Pipeline, over rows of
+// [ magnitude spectrum, power spectrum ] holding only the bins they read
+struct StackedBanks
+{
+    BinRange magnitudeRange, powerRange;
+    FilterMatrix matrix;
+    SparseFilterBank bank;
+    int melOffset, chromaticOffset;
+
+    StackedBanks( const MelSpectrum & mel, const ChromaticEntropy & chromatic ):
+        magnitudeRange(mel.inputRange()),
+        powerRange(chromatic.inputRange())
+    {
+        melOffset = matrix.append( mel.filterBank(), - magnitudeRange.begin );
+        chromaticOffset = matrix.append( chromatic.filterBank(),
+                                         magnitudeRange.size() - powerRange.begin );
+
+        bank.append( mel.filterBank(), - magnitudeRange.begin );
+        while (bank.filterCount() < chromaticOffset)
+            bank.addFilter( 0, 0, 0 );
+        bank.append( chromatic.filterBank(), magnitudeRange.size() - powerRange.begin );
+    }
+
+    int inputSize() const { return magnitudeRange.size() + powerRange.size(); }
+    int outputSize() const { return matrix.outputSize(); }
+};
+
+static bool closeBands( const vector<float> & a, const vector<float> & b,
+                        int stride, int frames, int offset, int count )
+{
+    for (int frame = 0; frame < frames; ++frame) {
+        for (int i = offset; i < offset + count; ++i) {
+            float x = a[frame * stride + i];
+            float y = b[frame * stride + i];
+            if (!(std::fabs( x - y ) <= 1e-5f * std::max( std::fabs(x), std::fabs(y) ) + 1e-7f))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Applies the stacked filters to random spectra with the sparse bank frame by frame
+// and with the matrix, on each available instruction set, and compares the bands
+// to those of the scalar sparse bank.
+int main()
+{
+    Test::Checks checks;
+
+    MelSpectrum mel( 27, 11025, 512 );
+    ChromaticEntropy chromatic( 11025, 512, 55, 2000 );
+    StackedBanks stacked( mel, chromatic );
+
+    // More than one block of frames of the matrix, and a partial one
+    const int frameCount = FilterMatrix::s_frameBlock + 13;
+    const int inputStride = stacked.inputSize();
+    const int outputStride = stacked.outputSize();
+
+    checks.check( stacked.bank.filterCount() <= outputStride,
+                  "sparse bank fits in the output rows of the matrix" );
+
+    vector<float> spectra( frameCount * inputStride );
+    unsigned int random = 1;
+    for (size_t i = 0; i < spectra.size(); ++i) {
+        random = random * 1103515245u + 12345u;
+        spectra[i] = (float) ((random >> 8) & 0xffff) / 0xffff;
+    }
+
+    vector<float> reference( frameCount * outputStride, 0.f );
+    checks.check( selectKernels( ScalarInstructions ), "select scalar kernels" );
+    for (int frame = 0; frame < frameCount; ++frame)
+        stacked.bank.process( spectra.data() + frame * inputStride,
+                              reference.data() + frame * outputStride );
+
+    for (int isa = ScalarInstructions; isa <= Avx512Instructions; ++isa)
+    {
+        if (!selectKernels( (InstructionSet) isa ))
+            continue;
+
+        vector<float> sparse( frameCount * outputStride, 0.f );
+        for (int frame = 0; frame < frameCount; ++frame)
+            stacked.bank.process( spectra.data() + frame * inputStride,
+                                  sparse.data() + frame * outputStride );
+
+        vector<float> dense( frameCount * outputStride, 0.f );
+        stacked.matrix.process( spectra.data(), inputStride, frameCount,
+                                dense.data(), outputStride );
+
+        const string name = kernels().name;
+        const vector<float> * results[] = { &sparse, &dense };
+        const char * methods[] = { "sparse bank", "filter matrix" };
+        for (int m = 0; m < 2; ++m) {
+            checks.check( closeBands( *results[m], reference, outputStride, frameCount,
+                                      stacked.melOffset, mel.filterBank().filterCount() ),
+                          name + " " + methods[m] + ": mel bands" );
+            checks.check( closeBands( *results[m], reference, outputStride, frameCount,
+                                      stacked.chromaticOffset, chromatic.filterBank().filterCount() ),
+                          name + " " + methods[m] + ": chromatic bands" );
+        }
+    }
+
+    return checks.finish( "filter bank" );
+}
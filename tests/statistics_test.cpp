@@ -0,0 +1,122 @@
+/*
+    Etno Segmenter - automatic segmentation of etnomusicological recordings
+
+    Copyright (c) 2012 - 2013 Matija Marolt & Jakob Leben
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+#include "checks.hpp"
+#include "../modules/statistics.hpp"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+using namespace std;
+using namespace Segmenter;
+
+typedef vector<Statistics::OutputFeatures> Outputs;
+
+// Feature frames of a made up recording, with about 3 in 4 frames passing the gate,
+// and all features of one gated and one ungated frame not a number
+static vector<Statistics::InputFeatures> makeFrames( int count, int gatedNan, int ungatedNan )
+{
+    vector<Statistics::InputFeatures> frames( count );
+    unsigned int random = 1;
+    for (int i = 0; i < count; ++i) {
+        for (int f = 0; f < Statistics::INPUT_FEATURE_COUNT; ++f) {
+            random = random * 1103515245u + 12345u;
+            frames[i].data[f] = 100.f * f + (float) ((random >> 8) & 0xffff) / 0xffff;
+        }
+        random = random * 1103515245u + 12345u;
+        frames[i][Statistics::ENERGY_GATE] = ((random >> 16) & 3) ? 1.f : 0.f;
+    }
+
+    const float nan = numeric_limits<float>::quiet_NaN();
+    for (int f = 0; f < Statistics::INPUT_FEATURE_COUNT; ++f)
+        frames[gatedNan].data[f] = frames[ungatedNan].data[f] = nan;
+    frames[gatedNan][Statistics::ENERGY_GATE] = 1.f;
+    frames[ungatedNan][Statistics::ENERGY_GATE] = 0.f;
+    return frames;
+}
+
+static Outputs statistics( const vector<Statistics::InputFeatures> & frames,
+                           bool incremental, int lookahead )
+{
+    Statistics statistics( 129, 16, 5, incremental, lookahead );
+    Outputs outputs;
+    for (size_t i = 0; i < frames.size(); ++i)
+        statistics.process( frames[i], outputs );
+    statistics.processRemainingData( outputs );
+    return outputs;
+}
+
+// Incremental statistics follow the windowed ones: not finite exactly
+// while the window holds a non-finite value, and close otherwise.
+static bool sameStatistics( const Outputs & incremental, const Outputs & windowed )
+{
+    if (incremental.size() != windowed.size())
+        return false;
+    for (size_t i = 0; i < windowed.size(); ++i) {
+        for (int f = 0; f < Statistics::OUTPUT_FEATURE_COUNT; ++f) {
+            double a = incremental[i].data[f];
+            double b = windowed[i].data[f];
+            if (std::isfinite(a) != std::isfinite(b))
+                return false;
+            if (std::isfinite(b) && std::fabs(a - b) > 1e-3 * std::max( 1.0, std::fabs(b) ))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool finite( const Statistics::OutputFeatures & output )
+{
+    for (int f = 0; f < Statistics::OUTPUT_FEATURE_COUNT; ++f)
+        if (!std::isfinite( output.data[f] ))
+            return false;
+    return true;
+}
+
+// Takes statistics of frames holding non-finite values incrementally
+// and over each window, with centred and causal windows.
+int main()
+{
+    Test::Checks checks;
+
+    const vector<Statistics::InputFeatures> frames = makeFrames( 1000, 300, 600 );
+
+    const int lookaheads[] = { -1, 0, 32 };
+    for (size_t l = 0; l < sizeof(lookaheads) / sizeof(lookaheads[0]); ++l)
+    {
+        ostringstream name;
+        name << "lookahead " << lookaheads[l] << ": ";
+
+        const Outputs windowed = statistics( frames, false, lookaheads[l] );
+        const Outputs incremental = statistics( frames, true, lookaheads[l] );
+
+        int nonFinite = 0;
+        for (size_t i = 0; i < windowed.size(); ++i)
+            nonFinite += finite( windowed[i] ) ? 0 : 1;
+        checks.check( !windowed.empty() && finite( windowed.front() ) && finite( windowed.back() )
+                      && nonFinite > 0 && nonFinite < 24,
+                      name.str() + "windowed statistics not finite only around the non-finite frames" );
+        checks.check( sameStatistics( incremental, windowed ),
+                      name.str() + "incremental statistics match the windowed ones" );
+    }
+
+    return checks.finish( "statistics" );
+}